@@ -5,316 +5,200 @@
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "hardware/pio.h"
-#include "WS2812.pio.h" 
 #include "drivers/logging/logging.h"
+#include "drivers/scheduler.h"
+#include "drivers/IR.h"
+#include "drivers/ring_buffer.h"
+#include "drivers/tm1637.h"
 #include "hardware/adc.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
 
-// TM1637 7-segment display pins
-#define TM1637_DIO_PIN 18
-#define TM1637_CLK_PIN 19
-#define TM1637_DIO_PIN2 11
-#define TM1637_CLK_PIN2 12
 #define BBIF_PIN 4 // IR sensor pins
 
-// Function prototypes for TM1637 display
-void tm1637_init_IR2();
-void tm1637_start_IR2();
-void tm1637_stop_IR2();
-void tm1637_write_byte_IR2(uint8_t b);
-void tm1637_display_digits_IR2(int d0, int d1, int d2, int d3, bool colon);
-void tm1637_set_brightness_IR2(uint8_t brightness);
-
-const uint8_t digitToSegment[] = {
-    0x3f, // 0
-    0x06, // 1
-    0x5b, // 2
-    0x4f, // 3
-    0x66, // 4
-    0x6d, // 5
-    0x7d, // 6
-    0x07, // 7
-    0x7f, // 8
-    0x6f  // 9
-};
-
-// Start communication with the TM1637 display
-void tm1637_start_IR() {
-    gpio_put(TM1637_CLK_PIN, 1);
-    gpio_put(TM1637_DIO_PIN, 1);
-    sleep_us(2);
-    gpio_put(TM1637_DIO_PIN, 0);
-    sleep_us(2);
-    gpio_put(TM1637_CLK_PIN, 0);
-}
-
-// Stop communication with the TM1637 display
-void tm1637_stop_IR() {
-    gpio_put(TM1637_CLK_PIN, 0);
-    sleep_us(2);
-    gpio_put(TM1637_DIO_PIN, 0);
-    sleep_us(2);
-    gpio_put(TM1637_CLK_PIN, 1);
-    sleep_us(2);
-    gpio_put(TM1637_DIO_PIN, 1);
-}
-
-// Write a byte to the TM1637 display
-void tm1637_write_byte_IR(uint8_t b) {
-    for (int i = 0; i < 8; i++) {
-        gpio_put(TM1637_CLK_PIN, 0);
-        gpio_put(TM1637_DIO_PIN, (b >> i) & 1);
-        sleep_us(3);
-        gpio_put(TM1637_CLK_PIN, 1);
-        sleep_us(3);
+// --- Beam break capture
+// The falling edge of the beam sensor is timestamped in the GPIO interrupt, so lap times have microsecond resolution
+// no matter how late the tasks below get to run. Debouncing is done on those timestamps.
+static RingBuffer<uint64_t, 16> ir_beam_breaks;
+static volatile uint32_t ir_beam_overruns = 0; // Only the handler writes it; the tasks keep their own reported count
+static uint32_t ir_beam_overruns_reported = 0;
+
+static void ir_beam_irq_handler() {
+    if (gpio_get_irq_event_mask(BBIF_PIN) & GPIO_IRQ_EDGE_FALL) {
+        gpio_acknowledge_irq(BBIF_PIN, GPIO_IRQ_EDGE_FALL);
+        if (!ir_beam_breaks.push(time_us_64())) {
+            ir_beam_overruns = ir_beam_overruns + 1;
+        }
     }
-    // Wait for ACK
-    gpio_put(TM1637_CLK_PIN, 0);
-    gpio_set_dir(TM1637_DIO_PIN, GPIO_IN);
-    sleep_us(5);
-    gpio_put(TM1637_CLK_PIN, 1);
-    sleep_us(5);
-    gpio_set_dir(TM1637_DIO_PIN, GPIO_OUT);
-    gpio_put(TM1637_CLK_PIN, 0);
-}
-
-// Set brightness and display control
-void tm1637_set_brightness_IR(uint8_t brightness) {
-    tm1637_start_IR();
-    tm1637_write_byte_IR(0x88 | (brightness & 0x07));
-    tm1637_stop_IR();
-}
-
-// Display digits on the TM1637 display
-// d0-d3 are the digits to display, colon indicates whether to show a colon
-void tm1637_display_digits_IR(int d0, int d1, int d2, int d3, bool colon) {
-    tm1637_start_IR();
-    tm1637_write_byte_IR(0x40); // Set auto-increment mode
-    tm1637_stop_IR();
-
-    // Write data to display
-    tm1637_start_IR();
-    tm1637_write_byte_IR(0xc0); // Start address 0
-    tm1637_write_byte_IR(digitToSegment[d0]);
-    uint8_t seg1 = digitToSegment[d1];
-    if (colon) seg1 |= 0x80; // Add colon if needed
-    tm1637_write_byte_IR(seg1);
-    tm1637_write_byte_IR(digitToSegment[d2]);
-    tm1637_write_byte_IR(digitToSegment[d3]);
-    tm1637_stop_IR();
-}
-
-// Initialize the TM1637 display for IR
-void tm1637_init_IR() {
-    gpio_init(TM1637_DIO_PIN);
-    gpio_init(TM1637_CLK_PIN);
-    gpio_set_dir(TM1637_DIO_PIN, GPIO_OUT);
-    gpio_set_dir(TM1637_CLK_PIN, GPIO_OUT);
 }
 
 // Initialize the IR sensor GPIO
+// The interrupt is routed to the calling core, so call this from the core that runs the lap timer.
 void init_IR() {
     gpio_init(BBIF_PIN);
     gpio_set_dir(BBIF_PIN, GPIO_IN);
     gpio_pull_up(BBIF_PIN);
+
+    gpio_add_raw_irq_handler(BBIF_PIN, ir_beam_irq_handler);
+    gpio_set_irq_enabled(BBIF_PIN, GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
 }
 
-// Function to run the IR timing system
-void run_IR() {
+// --- Lap timer state, shared by the beam processing and display tasks
+static bool timing = false;
+static uint64_t lap_start_us = 0;
+
+// Variables for last lap time - make sure these persist
+static uint32_t last_lap_ms = 0;
+static bool has_lap_time = false;
+static int total_laps = 0;  // Track total laps for debugging
+
+// Beam break debouncing, applied to the interrupt timestamps
+static uint64_t last_break_us = 0;
+static const uint32_t DEBOUNCE_TIME_US = 50000; // 50ms debounce
+
+// Scheduler periods: breaks are already timestamped, so they only need draining promptly enough to report laps
+#define IR_POLL_PERIOD_US 20000
+#define IR_DISPLAY_PERIOD_US 100000
+static sched_task_id ir_poll_task_id = -1;
+static sched_task_id ir_display_task_id = -1;
+
+// Called with each completed lap time in ms
+static ir_lap_callback_t ir_lap_callback = nullptr;
+
+// One-time initialisation of the sensor and both displays
+static void ir_init_once() {
     static bool initialised = false;
     if (!initialised) {
-        tm1637_init_IR();
+        tm1637_main_display.init();
         init_IR();
-        tm1637_set_brightness_IR(7); // Max brightness
         
         // Initialize second display
-        tm1637_init_IR2();
-        tm1637_set_brightness_IR2(7); // Max brightness
+        tm1637_lap_display.init();
         initialised = true;
-        printf("IR system initialized.\n");
+        LOG_INFO(MODULE_IR, "IR system initialized.");
     }
+}
 
-    // Static variables to keep state between calls
-    static int minutes = 0;
-    static int seconds = 0;
-    static bool timing = false;
-    static absolute_time_t last_tick;
-    static bool last_beam = true;
-    
-    // Variables for last lap time - make sure these persist
-    static int last_lap_minutes = -1;  // Use -1 to indicate no lap yet
-    static int last_lap_seconds = -1;
-    static bool has_lap_time = false;
-    static int total_laps = 0;  // Track total laps for debugging
-
-    bool beam_present = gpio_get(BBIF_PIN);
-
-    // Beam break detection with debouncing
-    static absolute_time_t last_beam_change = {0};
-    static const uint32_t DEBOUNCE_TIME_US = 50000; // 50ms debounce
-    
-    // Check if beam state has changed
-    if (last_beam != beam_present) {
-        absolute_time_t now = get_absolute_time();
-        if (absolute_time_diff_us(last_beam_change, now) > DEBOUNCE_TIME_US) {
-            last_beam_change = now;
+// Process the beam breaks captured by the interrupt and complete laps
+void ir_poll_beam() {
+    uint64_t break_us;
+    while (ir_beam_breaks.pop(&break_us)) {
+        // Ignore bounces and the trailing parts of the same car
+        if (last_break_us != 0 && break_us - last_break_us < DEBOUNCE_TIME_US) {
+            continue;
+        }
+        last_break_us = break_us;
+
+        if (!timing) {
+            // Start timer
+            timing = true;
+            lap_start_us = break_us;
+            LOG_INFO(MODULE_IR, "Car passed! Timer started.");
+        } else {
+            // Lap completed, rounded to the nearest ms
+            uint32_t lap_ms = (uint32_t)((break_us - lap_start_us + 500) / 1000);
+            total_laps++;
+            LOG_INFO(MODULE_IR, "Lap %d completed: %lu.%03lu s", total_laps, (unsigned long)(lap_ms / 1000),
+                     (unsigned long)(lap_ms % 1000));
             
-            if (last_beam && !beam_present) { // Beam just broken
-                if (!timing) {
-                    // Start timer
-                    timing = true;
-                    minutes = 0;
-                    seconds = 0;
-                    last_tick = get_absolute_time();
-                    printf("Car passed! Timer started.\n");
-                } else {
-                    // Lap completed
-                    total_laps++;
-                    printf("=== LAP %d COMPLETED ===\n", total_laps);
-                    printf("Lap time: %02d:%02d\n", minutes, seconds);
-                    
-                    // Save the lap time - these should persist!
-                    last_lap_minutes = minutes;
-                    last_lap_seconds = seconds;
-                    has_lap_time = true;
-                    
-                    printf("Stored lap time: %02d:%02d (has_lap_time=%s)\n", 
-                           last_lap_minutes, last_lap_seconds, 
-                           has_lap_time ? "TRUE" : "FALSE");
-                    
-                    // Reset timer for next lap
-                    minutes = 0;
-                    seconds = 0;
-                    last_tick = get_absolute_time();
-                    printf("Timer reset for next lap.\n");
-                    printf("========================\n");
-                }
+            // Save the lap time - these should persist!
+            last_lap_ms = lap_ms;
+            has_lap_time = true;
+            if (ir_lap_callback != nullptr) {
+                ir_lap_callback(lap_ms);
             }
+            
+            // The next lap starts at the exact moment this one ended
+            lap_start_us = break_us;
         }
-        last_beam = beam_present;
     }
 
-    // Timer increment
-    if (timing) {
-        if (absolute_time_diff_us(last_tick, get_absolute_time()) >= 1000000) {
-            last_tick = delayed_by_us(last_tick, 1000000);
-            seconds++;
-            if (seconds > 59) {
-                seconds = 0;
-                minutes++;
-                if (minutes > 99) minutes = 0;
-            }
-        }
+    // Read the count once: breaks the handler loses after this are reported next time
+    uint32_t overruns = ir_beam_overruns;
+    if (overruns != ir_beam_overruns_reported) {
+        LOG_WARNING(MODULE_IR, "%lu beam breaks lost, queue full",
+                    (unsigned long)(overruns - ir_beam_overruns_reported));
+        ir_beam_overruns_reported = overruns;
     }
+}
 
+// Show a time in ms as SS:hh (seconds and hundredths) below 100 s, and as MM:SS above that
+static void ir_time_digits(uint32_t time_ms, int digits[4]) {
+    int hi, lo;
+    if (time_ms < 100000) {
+        hi = time_ms / 1000;
+        lo = (time_ms % 1000) / 10;
+    } else {
+        uint32_t total_seconds = time_ms / 1000;
+        hi = (total_seconds / 60) % 100;
+        lo = total_seconds % 60;
+    }
+    digits[0] = hi / 10;
+    digits[1] = hi % 10;
+    digits[2] = lo / 10;
+    digits[3] = lo % 10;
+}
+
+// Show the running timer and the last lap time
+void ir_update_displays() {
     // Display current timer on first display
-    int d0 = minutes / 10;
-    int d1 = minutes % 10;
-    int d2 = seconds / 10;
-    int d3 = seconds % 10;
-    tm1637_display_digits_IR(d0, d1, d2, d3, true);
+    uint32_t elapsed_ms = timing ? (uint32_t)((time_us_64() - lap_start_us) / 1000) : 0;
+    int d[4];
+    ir_time_digits(elapsed_ms, d);
+    tm1637_main_display.show_digits(d[0], d[1], d[2], d[3], true);
     
     // Display on second screen - CRITICAL: This should maintain lap time
-    if (has_lap_time && last_lap_minutes >= 0 && last_lap_seconds >= 0) {
+    if (has_lap_time) {
         // Show the stored lap time
-        int ld0 = last_lap_minutes / 10;
-        int ld1 = last_lap_minutes % 10;
-        int ld2 = last_lap_seconds / 10;
-        int ld3 = last_lap_seconds % 10;
-        tm1637_display_digits_IR2(ld0, ld1, ld2, ld3, true);
+        int ld[4];
+        ir_time_digits(last_lap_ms, ld);
+        tm1637_lap_display.show_digits(ld[0], ld[1], ld[2], ld[3], true);
         
         // Debug output every 5 seconds to verify persistence
-        static absolute_time_t last_debug = {0};
-        if (absolute_time_diff_us(last_debug, get_absolute_time()) >= 5000000) {
-            printf("Second display: %02d:%02d (stored: %02d:%02d, total_laps=%d)\n", 
-                   ld0*10+ld1, ld2*10+ld3, last_lap_minutes, last_lap_seconds, total_laps);
-            last_debug = get_absolute_time();
+        static uint64_t last_debug_us = 0;
+        if (time_us_64() - last_debug_us >= 5000000) {
+            LOG_VERBOSE(MODULE_IR, "Second display: %d%d:%d%d", ld[0], ld[1], ld[2], ld[3]);
+            LOG_VERBOSE(MODULE_IR, "Stored lap: %lu ms, total_laps=%d", (unsigned long)last_lap_ms, total_laps);
+            TM1637Stats main_stats = tm1637_main_display.stats();
+            TM1637Stats lap_stats = tm1637_lap_display.stats();
+            LOG_VERBOSE(MODULE_IR, "Display frames sent/skipped: %lu/%lu and %lu/%lu",
+                        (unsigned long)main_stats.frames_sent, (unsigned long)main_stats.frames_skipped,
+                        (unsigned long)lap_stats.frames_sent, (unsigned long)lap_stats.frames_skipped);
+            last_debug_us = time_us_64();
         }
     } else {
         // Show dashes or 00:00 until first lap
-        tm1637_display_digits_IR2(0, 0, 0, 0, false);
+        tm1637_lap_display.show_digits(0, 0, 0, 0, false);
     }
 }
 
-// Start communication with the second TM1637 display
-void tm1637_start_IR2() {
-    gpio_put(TM1637_CLK_PIN2, 1);
-    gpio_put(TM1637_DIO_PIN2, 1);
-    sleep_us(2);
-    gpio_put(TM1637_DIO_PIN2, 0);
-    sleep_us(2);
-    gpio_put(TM1637_CLK_PIN2, 0);
+// Function to run the IR timing system
+// Processes pending beam breaks and refreshes the displays; ir_start_tasks() runs these on their own periods instead.
+void run_IR() {
+    ir_init_once();
+    ir_poll_beam();
+    ir_update_displays();
 }
 
-// Stop communication with the second TM1637 display
-void tm1637_stop_IR2() {
-    gpio_put(TM1637_CLK_PIN2, 0);
-    sleep_us(2);
-    gpio_put(TM1637_DIO_PIN2, 0);
-    sleep_us(2);
-    gpio_put(TM1637_CLK_PIN2, 1);
-    sleep_us(2);
-    gpio_put(TM1637_DIO_PIN2, 1);
+// Register a function to be called with each completed lap time
+void ir_set_lap_callback(ir_lap_callback_t callback) {
+    ir_lap_callback = callback;
 }
 
-// Write a byte to the second TM1637 display
-void tm1637_write_byte_IR2(uint8_t b) {
-    for (int i = 0; i < 8; i++) {
-        gpio_put(TM1637_CLK_PIN2, 0);
-        gpio_put(TM1637_DIO_PIN2, (b >> i) & 1);
-        sleep_us(3);
-        gpio_put(TM1637_CLK_PIN2, 1);
-        sleep_us(3);
+// Register the beam polling and display tasks with the scheduler of the calling core
+void ir_start_tasks() {
+    if (ir_poll_task_id >= 0) {
+        return;
     }
-    // Wait for ACK
-    gpio_put(TM1637_CLK_PIN2, 0);
-    gpio_set_dir(TM1637_DIO_PIN2, GPIO_IN);
-    sleep_us(5);
-    gpio_put(TM1637_CLK_PIN2, 1);
-    sleep_us(5);
-    gpio_set_dir(TM1637_DIO_PIN2, GPIO_OUT);
-    gpio_put(TM1637_CLK_PIN2, 0);
+    ir_init_once();
+    ir_poll_task_id = sched_add_periodic(ir_poll_beam, IR_POLL_PERIOD_US);
+    ir_display_task_id = sched_add_periodic(ir_update_displays, IR_DISPLAY_PERIOD_US);
 }
 
-// Display digits on the second TM1637 display
-void tm1637_display_digits_IR2(int d0, int d1, int d2, int d3, bool colon) {
-    // Set auto-increment mode
-    tm1637_start_IR2();
-    tm1637_write_byte_IR2(0x40);
-    tm1637_stop_IR2();
-
-    // Write data to display
-    tm1637_start_IR2();
-    tm1637_write_byte_IR2(0xc0); // Start address 0
-    tm1637_write_byte_IR2(digitToSegment[d0]);
-    uint8_t seg1 = digitToSegment[d1];
-    if (colon) seg1 |= 0x80; // Add colon if needed
-    tm1637_write_byte_IR2(seg1);
-    tm1637_write_byte_IR2(digitToSegment[d2]);
-    tm1637_write_byte_IR2(digitToSegment[d3]);
-    tm1637_stop_IR2();
-    
-    // Set display control (brightness + on)
-    tm1637_start_IR2();
-    tm1637_write_byte_IR2(0x8F); // Display ON + max brightness
-    tm1637_stop_IR2();
+void ir_stop_tasks() {
+    sched_cancel(ir_poll_task_id);
+    sched_cancel(ir_display_task_id);
+    ir_poll_task_id = -1;
+    ir_display_task_id = -1;
 }
-
-// Set brightness for the second TM1637 display
-void tm1637_set_brightness_IR2(uint8_t brightness) {
-    tm1637_start_IR2();
-    tm1637_write_byte_IR2(0x88 | (brightness & 0x07));
-    tm1637_stop_IR2();
-}
-
-// Initialize the second TM1637 display for IR
-void tm1637_init_IR2() {
-    gpio_init(TM1637_DIO_PIN2);
-    gpio_init(TM1637_CLK_PIN2);
-    gpio_set_dir(TM1637_DIO_PIN2, GPIO_OUT);
-    gpio_set_dir(TM1637_CLK_PIN2, GPIO_OUT);
-
-    gpio_put(TM1637_DIO_PIN2, 1);  // Start high
-    gpio_put(TM1637_CLK_PIN2, 1);  // Start high
-    sleep_ms(10);  // Give time for initialization
-}
-
@@ -1,17 +1,12 @@
 #pragma once
 
-void tm1637_init_IR();
-void tm1637_start_IR();
-void tm1637_stop_IR();
-void tm1637_write_byte_IR(uint8_t b);
-void tm1637_set_brightness_IR(uint8_t brightness);
-void tm1637_display_digits_IR(int d0, int d1, int d2, int d3, bool colon);
-void run_IR();
+#include <stdint.h>
 
-void tm1637_init_IR2();
-void tm1637_start_IR2();
-void tm1637_stop_IR2();
-void tm1637_write_byte_IR2(uint8_t b);
-void tm1637_display_digits_IR2(int d0, int d1, int d2, int d3, bool colon);
-void tm1637_set_brightness_IR2(uint8_t brightness);
+typedef void (*ir_lap_callback_t)(uint32_t lap_ms);
 
+void run_IR();
+void ir_poll_beam();
+void ir_update_displays();
+void ir_start_tasks();
+void ir_stop_tasks();
+void ir_set_lap_callback(ir_lap_callback_t callback);
@@ -0,0 +1,129 @@
+// Calibration storage in the last two sectors of flash.
+//
+// Each save appends a CRC-checked record to the next free 256-byte page, so a sector is only erased once every 16
+// saves. When the active sector fills up, the other sector is erased and used instead, which means the previous
+// record survives until the new one has been written. On boot, the valid record with the highest sequence number wins.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "drivers/calibration_store.h"
+
+#define CAL_MAGIC 0x4C43414C // "LCAL"
+#define CAL_VERSION 1
+#define CAL_SECTORS 2
+#define CAL_SLOTS_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define CAL_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - CAL_SECTORS * FLASH_SECTOR_SIZE)
+
+// On-flash layout. Only append fields, and bump CAL_VERSION when the meaning of a field changes.
+struct CalibrationRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length; // sizeof(CalibrationRecord) when written
+    uint32_t sequence;
+    CalibrationData data;
+    uint32_t crc; // CRC-32 of all preceding bytes
+};
+
+static_assert(sizeof(CalibrationRecord) <= FLASH_PAGE_SIZE, "Calibration record must fit in one flash page");
+
+// Standard reflected CRC-32 (polynomial 0xEDB88320), computed bitwise to avoid a 1 KB table
+static uint32_t cal_crc32(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+// Flash offset of a slot, counting across both sectors
+static uint32_t cal_slot_offset(int slot) {
+    return CAL_FLASH_OFFSET + slot * FLASH_PAGE_SIZE;
+}
+
+// Flash is memory mapped, so records can be read in place
+static const CalibrationRecord *cal_slot(int slot) {
+    return (const CalibrationRecord *)(XIP_BASE + cal_slot_offset(slot));
+}
+
+static bool cal_slot_is_empty(int slot) {
+    return cal_slot(slot)->magic == 0xFFFFFFFF;
+}
+
+static bool cal_slot_is_valid(int slot) {
+    const CalibrationRecord *record = cal_slot(slot);
+    return record->magic == CAL_MAGIC
+        && record->version == CAL_VERSION
+        && record->length == sizeof(CalibrationRecord)
+        && record->crc == cal_crc32((const uint8_t *)record, offsetof(CalibrationRecord, crc));
+}
+
+// Find the slot holding the newest valid record, or -1 if there is none
+static int cal_find_latest() {
+    int latest = -1;
+    for (int slot = 0; slot < CAL_SECTORS * CAL_SLOTS_PER_SECTOR; slot++) {
+        if (cal_slot_is_valid(slot) && (latest < 0 || (int32_t)(cal_slot(slot)->sequence - cal_slot(latest)->sequence) > 0)) {
+            latest = slot;
+        }
+    }
+    return latest;
+}
+
+bool calibration_load(CalibrationData *data) {
+    int latest = cal_find_latest();
+    if (latest < 0) {
+        return false;
+    }
+    *data = cal_slot(latest)->data;
+    return true;
+}
+
+bool calibration_save(const CalibrationData *data) {
+    int latest = cal_find_latest();
+    uint32_t sequence = latest < 0 ? 0 : cal_slot(latest)->sequence + 1;
+
+    // Use the next slot after the newest record. If that runs off the end of its sector, or holds a corrupt
+    // record, move on to the start of the other sector, which has to be erased first.
+    int slot = latest + 1;
+    int sector = slot / CAL_SLOTS_PER_SECTOR;
+    if (latest < 0 || slot % CAL_SLOTS_PER_SECTOR == 0 || !cal_slot_is_empty(slot)) {
+        sector = latest < 0 ? 0 : (latest / CAL_SLOTS_PER_SECTOR + 1) % CAL_SECTORS;
+        slot = sector * CAL_SLOTS_PER_SECTOR;
+    }
+
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    CalibrationRecord record = {};
+    record.magic = CAL_MAGIC;
+    record.version = CAL_VERSION;
+    record.length = sizeof(CalibrationRecord);
+    record.sequence = sequence;
+    record.data = *data;
+    record.crc = cal_crc32((const uint8_t *)&record, offsetof(CalibrationRecord, crc));
+    memcpy(page, &record, sizeof(record));
+
+    // Nothing may execute from flash while it is being written, so core 1 (if running) is paused and interrupts are
+    // masked for the duration
+    bool lockout = multicore_lockout_victim_is_initialized(1);
+    if (lockout) {
+        multicore_lockout_start_blocking();
+    }
+    uint32_t interrupts = save_and_disable_interrupts();
+    if (slot % CAL_SLOTS_PER_SECTOR == 0) {
+        flash_range_erase(CAL_FLASH_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+    }
+    flash_range_program(cal_slot_offset(slot), page, FLASH_PAGE_SIZE);
+    restore_interrupts(interrupts);
+    if (lockout) {
+        multicore_lockout_end_blocking();
+    }
+
+    return cal_slot_is_valid(slot);
+}
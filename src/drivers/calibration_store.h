@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Load cell calibration persisted across reboots.
+struct CalibrationData {
+    int32_t tare_offset;
+    float calibration_factor;
+};
+
+/// Load the newest valid calibration record from flash. Returns false if there is none.
+bool calibration_load(CalibrationData *data);
+
+/// Append a new calibration record to flash. Returns false if the write could not be verified.
+bool calibration_save(const CalibrationData *data);
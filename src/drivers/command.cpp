@@ -0,0 +1,120 @@
+// UART command channel, using the style that state is global in the C file.
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "drivers/command.h"
+#include "drivers/ring_buffer.h"
+#include "drivers/scheduler.h"
+
+#define COMMAND_MAX_COMMANDS 16
+#define COMMAND_MAX_LINE 64
+#define COMMAND_MAX_ARGS 6
+#define COMMAND_POLL_PERIOD_US 20000
+#define COMMAND_RX_SIZE 256 // 22 ms of input at 115200 baud, so a burst from the Pi can't overrun between polls
+
+struct Command {
+    const char *name;
+    const char *usage;
+    command_handler_t handler;
+};
+
+static uart_inst_t *command_uart = nullptr;
+static RingBuffer<char, COMMAND_RX_SIZE> command_rx;
+static volatile uint32_t command_overruns = 0;
+
+static Command commands[COMMAND_MAX_COMMANDS];
+static int command_count = 0;
+
+static char command_line[COMMAND_MAX_LINE];
+static size_t command_line_length = 0;
+static bool command_line_overflow = false;
+static sched_task_id command_task_id = -1;
+
+// Move everything in the UART's receive FIFO into the ring
+static void command_rx_irq_handler() {
+    while (uart_is_readable(command_uart)) {
+        if (!command_rx.push(uart_getc(command_uart))) {
+            command_overruns = command_overruns + 1; // Only this handler writes it
+        }
+    }
+}
+
+static void command_help(int argc, char **argv) {
+    for (int i = 0; i < command_count; i++) {
+        printf("OK %s\n", commands[i].usage);
+    }
+}
+
+// Split the line into words in place and run the matching handler
+static void command_execute(char *line) {
+    char *argv[COMMAND_MAX_ARGS];
+    int argc = 0;
+    for (char *word = strtok(line, " \t"); word != nullptr; word = strtok(nullptr, " \t")) {
+        if (argc == COMMAND_MAX_ARGS) {
+            printf("ERR too many arguments\n");
+            return;
+        }
+        argv[argc++] = word;
+    }
+    if (argc == 0) {
+        return;
+    }
+
+    for (int i = 0; i < command_count; i++) {
+        if (strcmp(argv[0], commands[i].name) == 0) {
+            commands[i].handler(argc, argv);
+            return;
+        }
+    }
+    printf("ERR unknown command '%s', try 'help'\n", argv[0]);
+}
+
+void command_poll() {
+    char c;
+    while (command_rx.pop(&c)) {
+        if (c == '\r' || c == '\n') {
+            if (command_line_overflow) {
+                printf("ERR line too long\n");
+            } else {
+                command_line[command_line_length] = '\0';
+                command_execute(command_line);
+            }
+            command_line_length = 0;
+            command_line_overflow = false;
+        } else if (command_line_length < COMMAND_MAX_LINE - 1) {
+            command_line[command_line_length++] = c;
+        } else {
+            command_line_overflow = true;
+        }
+    }
+}
+
+bool command_register(const char *name, const char *usage, command_handler_t handler) {
+    if (command_count == COMMAND_MAX_COMMANDS) {
+        return false;
+    }
+    commands[command_count++] = {name, usage, handler};
+    return true;
+}
+
+void command_init(uart_inst_t *uart) {
+    if (command_task_id >= 0) {
+        return;
+    }
+    command_uart = uart;
+    command_register("help", "help", command_help);
+
+    int irq = uart == uart0 ? UART0_IRQ : UART1_IRQ;
+    irq_set_exclusive_handler(irq, command_rx_irq_handler);
+    irq_set_enabled(irq, true);
+    uart_set_irq_enables(uart, true, false);
+
+    command_task_id = sched_add_periodic(command_poll, COMMAND_POLL_PERIOD_US);
+}
+
+uint32_t command_rx_overruns() {
+    return command_overruns;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include "hardware/uart.h"
+
+// Line-based command channel on the console UART.
+//
+// Received characters are collected by the UART RX interrupt and parsed into lines by a scheduler task, so nothing
+// ever waits for input. A line is a command name followed by space-separated arguments, ended by CR or LF. Handlers
+// reply on the console with a line starting "OK" or "ERR", which the Pi controller can match.
+
+/// Handler for one command. argv[0] is the command name.
+typedef void (*command_handler_t)(int argc, char **argv);
+
+/// Take over receiving on `uart` (already initialised) and start parsing lines on the calling core's scheduler.
+void command_init(uart_inst_t *uart);
+
+/// Add a command. `usage` is shown by the built-in "help" command. Returns false if the table is full.
+bool command_register(const char *name, const char *usage, command_handler_t handler);
+
+/// Parse and run any complete lines received so far. command_init() runs this periodically.
+void command_poll();
+
+/// Characters lost because the receive buffer was full.
+uint32_t command_rx_overruns();
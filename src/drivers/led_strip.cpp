@@ -0,0 +1,115 @@
+// WS2812 LED strip fed by DMA, using the style that state is global in the C file.
+//
+// Frames are double-buffered: the CPU draws into the back buffer while a DMA channel, paced by the state machine's TX
+// DREQ, feeds the front buffer to ws2812_program. Showing a frame swaps the buffers and starts the transfer, so it
+// costs the CPU one buffer copy instead of blocking for 30 us per LED. The DMA completion interrupt (DMA_IRQ_1, as
+// uart_tx has DMA_IRQ_0) only marks the transfer finished; the strip latches once the FIFO has drained and the line
+// has been low for the reset time, and the next frame must not start before then.
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+#include "drivers/led_strip.h"
+#include "WS2812.pio.h"
+
+#define LED_STRIP_MAX_LEDS 1024
+#define LED_STRIP_FREQ 800000
+#define LED_STRIP_US_PER_LED 30 // 24 bits at 800 kHz
+#define LED_STRIP_FIFO_WORDS 8  // Joined TX FIFO, still being shifted out when the DMA finishes
+#define LED_STRIP_RESET_US 300  // Low time that latches the frame (280 us for WS2812B)
+
+// Each word is one LED: green, red and blue in the top 24 bits, which the state machine shifts out MSB first
+static uint32_t strip_buffers[2][LED_STRIP_MAX_LEDS];
+static uint32_t *strip_back = strip_buffers[0];
+static uint32_t *strip_front = strip_buffers[1];
+static unsigned int strip_length = 0;
+
+static PIO strip_pio;
+static unsigned int strip_sm;
+static int strip_dma_channel = -1;
+static volatile bool strip_dma_busy = false;
+static volatile uint64_t strip_latched_us = 0; // When the last frame sent has latched
+static LedStripStats strip_stats = {0, 0};
+
+static void led_strip_dma_irq_handler() {
+    if (!dma_channel_get_irq1_status(strip_dma_channel)) {
+        return;
+    }
+    dma_channel_acknowledge_irq1(strip_dma_channel);
+    strip_latched_us = time_us_64() + LED_STRIP_FIFO_WORDS * LED_STRIP_US_PER_LED + LED_STRIP_RESET_US;
+    strip_dma_busy = false;
+}
+
+void led_strip_init(PIO pio, unsigned int pin, unsigned int num_leds) {
+    strip_pio = pio;
+    strip_length = num_leds < LED_STRIP_MAX_LEDS ? num_leds : LED_STRIP_MAX_LEDS;
+
+    uint offset = pio_add_program(pio, &ws2812_program);
+    strip_sm = pio_claim_unused_sm(pio, true);
+    ws2812_program_init(pio, strip_sm, offset, pin, LED_STRIP_FREQ, false);
+
+    strip_dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(strip_dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, strip_sm, true));
+    dma_channel_configure(strip_dma_channel, &c, &pio->txf[strip_sm], strip_front, 0, false);
+
+    dma_channel_set_irq1_enabled(strip_dma_channel, true);
+    irq_set_exclusive_handler(DMA_IRQ_1, led_strip_dma_irq_handler);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    // Whatever the strip showed before a reset is stale
+    led_strip_clear();
+    led_strip_show();
+}
+
+unsigned int led_strip_length() {
+    return strip_length;
+}
+
+void led_strip_set_pixel(unsigned int index, uint8_t r, uint8_t g, uint8_t b) {
+    if (index < strip_length) {
+        strip_back[index] = ((uint32_t)g << 24) | ((uint32_t)r << 16) | ((uint32_t)b << 8);
+    }
+}
+
+void led_strip_fill(unsigned int first, unsigned int count, uint8_t r, uint8_t g, uint8_t b) {
+    for (unsigned int i = first; i < first + count && i < strip_length; i++) {
+        led_strip_set_pixel(i, r, g, b);
+    }
+}
+
+void led_strip_clear() {
+    memset(strip_back, 0, strip_length * sizeof(strip_back[0]));
+}
+
+bool led_strip_busy() {
+    return strip_dma_busy || time_us_64() < strip_latched_us;
+}
+
+bool led_strip_show() {
+    if (led_strip_busy()) {
+        strip_stats.frames_skipped++;
+        return false;
+    }
+
+    uint32_t *frame = strip_back;
+    strip_back = strip_front;
+    strip_front = frame;
+    memcpy(strip_back, strip_front, strip_length * sizeof(strip_back[0]));
+
+    strip_dma_busy = true;
+    dma_channel_set_read_addr(strip_dma_channel, strip_front, false);
+    dma_channel_set_trans_count(strip_dma_channel, strip_length, true);
+    strip_stats.frames_shown++;
+    return true;
+}
+
+LedStripStats led_strip_stats() {
+    return strip_stats;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/pio.h"
+
+/// Frame statistics since led_strip_init().
+struct LedStripStats {
+    uint32_t frames_shown;
+    uint32_t frames_skipped; ///< led_strip_show() calls made while the previous frame was still being sent.
+};
+
+/// Drive a WS2812 strip of `num_leds` (at most 1024) on `pin`. Claims a state machine on `pio`, a DMA channel and
+/// DMA_IRQ_1. The strip starts dark.
+void led_strip_init(PIO pio, unsigned int pin, unsigned int num_leds);
+
+unsigned int led_strip_length();
+
+/// Set one LED in the frame being drawn. Out-of-range indices are ignored.
+void led_strip_set_pixel(unsigned int index, uint8_t r, uint8_t g, uint8_t b);
+
+/// Set `count` LEDs from `first` in the frame being drawn.
+void led_strip_fill(unsigned int first, unsigned int count, uint8_t r, uint8_t g, uint8_t b);
+
+void led_strip_clear();
+
+/// Send the frame being drawn to the strip and return straight away. Drawing carries on from the frame just shown.
+/// Returns false, leaving the frame to be shown later, if the previous one is still being sent or latched.
+bool led_strip_show();
+
+/// True while a frame is being sent or latched.
+bool led_strip_busy();
+
+LedStripStats led_strip_stats();
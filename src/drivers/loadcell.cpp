@@ -1,333 +1,707 @@
 #include <stdio.h>
 #include <math.h>
+#include <stdlib.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "hardware/pio.h"
 #include "hardware/i2c.h"
 #include <string.h>
+#include <stdint.h>
 #include "pico/binary_info.h"
 #include "hardware/adc.h"
+#include "hardware/irq.h"
+#include "HX711.pio.h"
+#include "drivers/loadcell.h"
+#include "drivers/calibration_store.h"
+#include "drivers/command.h"
+#include "drivers/scheduler.h"
+#include "drivers/logging/logging.h"
+#include "drivers/telemetry/telemetry.h"
+#include "drivers/telemetry/telemetry_batch.h"
+#include "drivers/tm1637.h"
 
-// Load cell and display configuration
+// Load cell configuration (the display is tm1637_main_display)
 #define HX711_DOUT_PIN 2
 #define HX711_SCK_PIN 3
-#define DISPLAY_DIO_PIN 18
-#define DISPLAY_CLK_PIN 19
 #define BBIF_PIN 4
 
-// UART configuration
-#define UART_ID uart0
-#define BAUD_RATE 115200
-#define TX_PIN 0
-#define RX_PIN 1
-
 // Add function declarations here
-void tm1637_init();
-void tm1637_start();
-void tm1637_stop();
-void tm1637_write_byte(uint8_t data);
 void display_weight(float weight_kg);
+void display_weight_g(int32_t weight_g);
+
+// HX711 state machine, loaded by hx711_init()
+static PIO hx711_pio = pio0;
+static uint hx711_sm = 0;
 
 // Loadcell initialisation
+// The 24-bit frame is clocked out by a PIO state machine, which pushes each sample into its RX FIFO.
 void hx711_init() {
     gpio_init(HX711_DOUT_PIN);
-    gpio_init(HX711_SCK_PIN);
     gpio_set_dir(HX711_DOUT_PIN, GPIO_IN);
-    gpio_set_dir(HX711_SCK_PIN, GPIO_OUT);
-    gpio_put(HX711_SCK_PIN, 0);
+
+    uint offset = pio_add_program(hx711_pio, &hx711_program);
+    hx711_sm = pio_claim_unused_sm(hx711_pio, true);
+    hx711_program_init(hx711_pio, hx711_sm, offset, HX711_DOUT_PIN, HX711_SCK_PIN);
+}
+
+// Sign extend a 24-bit two's complement HX711 sample
+static int32_t hx711_sign_extend(uint32_t data) {
+    if (data & 0x800000) {
+        data |= 0xFF000000;
+    }
+    return (int32_t)data;
+}
+
+// Non-blocking read: returns false if no new conversion is waiting in the FIFO
+bool hx711_try_read(int32_t *value) {
+    if (pio_sm_is_rx_fifo_empty(hx711_pio, hx711_sm)) {
+        return false;
+    }
+    *value = hx711_sign_extend(pio_sm_get(hx711_pio, hx711_sm));
+    return true;
 }
 
 // Function to read data from HX711 load cell, returns raw value
+// Blocks until the state machine delivers the next conversion.
 uint32_t hx711_read() {
-    uint32_t data = 0;
-    
-    // Wait for HX711 to be ready
-    while (gpio_get(HX711_DOUT_PIN)) {
-        sleep_us(1);
+    return (uint32_t)hx711_sign_extend(pio_sm_get_blocking(hx711_pio, hx711_sm));
+}
+
+// --- Continuous acquisition
+// The PIO RX FIFO interrupt copies every conversion into a history ring. The interrupt handler is the only writer:
+// it stores the sample and then bumps the count, so readers can copy the latest samples without locking and detect
+// if the handler lapped them while they were copying.
+#define LC_STREAM_SIZE 64 // Must be a power of two
+static volatile int32_t lc_samples[LC_STREAM_SIZE];
+static volatile uint32_t lc_sample_count = 0;
+static bool lc_streaming = false;
+
+// Drain the RX FIFO into the history ring
+static void hx711_irq_handler() {
+    while (!pio_sm_is_rx_fifo_empty(hx711_pio, hx711_sm)) {
+        uint32_t count = lc_sample_count;
+        lc_samples[count & (LC_STREAM_SIZE - 1)] = hx711_sign_extend(pio_sm_get(hx711_pio, hx711_sm));
+        lc_sample_count = count + 1;
     }
-    
-    // Read 24 bits
-    for (int i = 0; i < 24; i++) {
-        gpio_put(HX711_SCK_PIN, 1);
-        sleep_us(1);
-        data = (data << 1) | gpio_get(HX711_DOUT_PIN);
-        gpio_put(HX711_SCK_PIN, 0);
-        sleep_us(1);
+}
+
+// Start collecting samples in the background
+void lc_stream_start() {
+    if (lc_streaming) {
+        return;
     }
-    
-    // Set gain (1 extra pulse = 128 gain)
-    gpio_put(HX711_SCK_PIN, 1);
-    sleep_us(1);
-    gpio_put(HX711_SCK_PIN, 0);
-    
-    // Convert to signed if needed
-    if (data & 0x800000) {
-        data |= 0xFF000000;
+    irq_set_exclusive_handler(PIO0_IRQ_0, hx711_irq_handler);
+    pio_set_irq0_source_enabled(hx711_pio, (pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + hx711_sm), true);
+    irq_set_enabled(PIO0_IRQ_0, true);
+    lc_streaming = true;
+}
+
+// Stop collecting samples; hx711_read() and hx711_try_read() can be used again afterwards
+void lc_stream_stop() {
+    if (!lc_streaming) {
+        return;
+    }
+    pio_set_irq0_source_enabled(hx711_pio, (pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + hx711_sm), false);
+    irq_set_enabled(PIO0_IRQ_0, false);
+    irq_remove_handler(PIO0_IRQ_0, hx711_irq_handler);
+    lc_streaming = false;
+}
+
+// Total number of samples collected since the stream started
+uint32_t lc_stream_count() {
+    return lc_sample_count;
+}
+
+// Copy up to n of the most recent samples into out, oldest first. Returns the number copied.
+size_t lc_stream_latest(int32_t *out, size_t n) {
+    if (n > LC_STREAM_SIZE) {
+        n = LC_STREAM_SIZE;
+    }
+    for (;;) {
+        uint32_t end = lc_sample_count;
+        size_t available = end < n ? end : n;
+        uint32_t start = end - available;
+        for (size_t i = 0; i < available; i++) {
+            out[i] = lc_samples[(start + i) & (LC_STREAM_SIZE - 1)];
+        }
+        // Retry if the interrupt overwrote the oldest sample we copied
+        if (lc_sample_count - start <= LC_STREAM_SIZE) {
+            return available;
+        }
+    }
+}
+
+// Average the most recent n samples. Returns false if none have been collected yet.
+bool lc_stream_average(size_t n, int32_t *average) {
+    int32_t samples[LC_STREAM_SIZE];
+    size_t count = lc_stream_latest(samples, n);
+    if (count == 0) {
+        return false;
+    }
+    int64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    *average = (int32_t)(sum / (int64_t)count);
+    return true;
+}
+
+// Copy samples newer than *cursor into out, oldest first, and advance the cursor. Returns the number copied.
+// If the interrupt has lapped the reader, the samples that were overwritten are skipped.
+size_t lc_stream_read(uint32_t *cursor, int32_t *out, size_t max) {
+    for (;;) {
+        uint32_t end = lc_sample_count;
+        uint32_t start = *cursor;
+        if (end - start > LC_STREAM_SIZE) {
+            start = end - LC_STREAM_SIZE;
+        }
+        size_t count = end - start < max ? end - start : max;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = lc_samples[(start + i) & (LC_STREAM_SIZE - 1)];
+        }
+        if (lc_sample_count - start <= LC_STREAM_SIZE) {
+            *cursor = start + count;
+            return count;
+        }
     }
-    
-    return data;
 }
 
-// Function to convert raw HX711 value to weight in kg
+// Function to convert raw HX711 value to weight in kg. Readings below the zero offset give negative weights.
 float hx711_get_weight_kg(uint32_t raw_value, uint32_t zero_offset, float scale_factor) {
-    return (float)(raw_value - zero_offset) / scale_factor;
+    return (float)(int32_t)(raw_value - zero_offset) / scale_factor;
+}
+
+// --- Filter stage
+// Each filter updates in constant time per sample: the moving average keeps a running sum, the median keeps a sorted
+// copy of its (bounded) window, and the IIR keeps its state scaled up by 2^iir_shift so no precision is lost.
+static LcFilterConfig lc_filter_config = {LC_FILTER_MOVING_AVERAGE, 8, 3, 0, 3};
+static int32_t lc_filter_window[LC_FILTER_MAX_WINDOW]; // Raw samples in arrival order
+static int32_t lc_filter_sorted[LC_FILTER_MAX_WINDOW]; // The same samples, sorted, for the median
+static size_t lc_filter_next = 0;
+static size_t lc_filter_fill = 0;
+static int64_t lc_filter_sum = 0;
+static int64_t lc_filter_iir = 0;
+static int32_t lc_filter_value = 0;
+static uint32_t lc_filter_rejected = 0;
+static uint32_t lc_filter_rejected_total = 0;
+
+// Discard the filter history; the next sample primes the filter
+void lc_filter_reset() {
+    lc_filter_next = 0;
+    lc_filter_fill = 0;
+    lc_filter_sum = 0;
+    lc_filter_rejected = 0;
+}
+
+// Select and configure the filter. This also resets it.
+void lc_filter_configure(const LcFilterConfig *config) {
+    lc_filter_config = *config;
+    if (lc_filter_config.window < 1) {
+        lc_filter_config.window = 1;
+    } else if (lc_filter_config.window > LC_FILTER_MAX_WINDOW) {
+        lc_filter_config.window = LC_FILTER_MAX_WINDOW;
+    }
+    lc_filter_reset();
+}
+
+// Replace `old_value` in the sorted median window with `new_value`, keeping it sorted
+static void lc_filter_sorted_replace(size_t fill, int32_t old_value, int32_t new_value) {
+    size_t i = 0;
+    while (lc_filter_sorted[i] != old_value) {
+        i++;
+    }
+    // Shift neighbours into the hole until new_value fits
+    while (i > 0 && lc_filter_sorted[i - 1] > new_value) {
+        lc_filter_sorted[i] = lc_filter_sorted[i - 1];
+        i--;
+    }
+    while (i + 1 < fill && lc_filter_sorted[i + 1] < new_value) {
+        lc_filter_sorted[i] = lc_filter_sorted[i + 1];
+        i++;
+    }
+    lc_filter_sorted[i] = new_value;
+}
+
+// Feed one raw sample through the filter and return the filtered raw value
+int32_t lc_filter_push(int32_t raw) {
+    // Outlier rejection: hold the output for isolated spikes, but accept a persistent step (e.g. a load being placed)
+    if (lc_filter_config.outlier_threshold > 0 && lc_filter_fill > 0) {
+        int32_t deviation = raw - lc_filter_value;
+        if (deviation > lc_filter_config.outlier_threshold || deviation < -lc_filter_config.outlier_threshold) {
+            lc_filter_rejected_total++;
+            if (++lc_filter_rejected <= lc_filter_config.max_rejected) {
+                return lc_filter_value;
+            }
+            lc_filter_reset();
+        } else {
+            lc_filter_rejected = 0;
+        }
+    }
+
+    size_t window = lc_filter_config.window;
+    if (lc_filter_fill == 0) {
+        // Prime every filter with the first sample so the output starts at the current reading
+        for (size_t i = 0; i < window; i++) {
+            lc_filter_window[i] = raw;
+            lc_filter_sorted[i] = raw;
+        }
+        lc_filter_sum = (int64_t)raw * (int64_t)window;
+        lc_filter_iir = (int64_t)raw << lc_filter_config.iir_shift;
+        lc_filter_next = 0;
+        lc_filter_fill = window;
+    }
+
+    switch (lc_filter_config.type) {
+        case LC_FILTER_NONE:
+            lc_filter_value = raw;
+            break;
+        case LC_FILTER_MOVING_AVERAGE: {
+            lc_filter_sum += raw - lc_filter_window[lc_filter_next];
+            lc_filter_window[lc_filter_next] = raw;
+            lc_filter_value = (int32_t)(lc_filter_sum / (int64_t)window);
+            break;
+        }
+        case LC_FILTER_MEDIAN: {
+            lc_filter_sorted_replace(window, lc_filter_window[lc_filter_next], raw);
+            lc_filter_window[lc_filter_next] = raw;
+            lc_filter_value = lc_filter_sorted[window / 2];
+            break;
+        }
+        case LC_FILTER_IIR: {
+            // y += (x - y) / 2^shift, with y held as y * 2^shift
+            lc_filter_iir += raw - (lc_filter_iir >> lc_filter_config.iir_shift);
+            lc_filter_value = (int32_t)(lc_filter_iir >> lc_filter_config.iir_shift);
+            break;
+        }
+    }
+    lc_filter_next = (lc_filter_next + 1) % window;
+    return lc_filter_value;
+}
+
+// Latest filtered raw value
+int32_t lc_filter_output() {
+    return lc_filter_value;
+}
+
+// Number of samples dropped as outliers since boot
+uint32_t lc_filter_rejected_count() {
+    return lc_filter_rejected_total;
+}
+
+// --- Fixed-point conversion
+// The Cortex-M0+ has no FPU, so per-sample conversions use a precomputed grams-per-count reciprocal in Q24 format
+// instead of a soft-float divide. The reciprocal is only recomputed when the calibration changes.
+#define LC_SCALE_Q 24
+#define LC_MIN_SCALE_FACTOR 10.0f // Counts per kg; below this a full-scale reading overflows the gram result
+
+// True if a calibration factor in counts per kg is usable. Also rejects NaN and infinity.
+bool lc_scale_factor_valid(float scale_factor) {
+    return isfinite(scale_factor) && fabsf(scale_factor) >= LC_MIN_SCALE_FACTOR;
+}
+
+// Compute the Q24 grams-per-count scale for a calibration factor given in counts per kg.
+// The factor must pass lc_scale_factor_valid().
+int64_t lc_scale_from_factor(float scale_factor) {
+    return (int64_t)llroundf(1000.0f * (float)(1 << LC_SCALE_Q) / scale_factor);
+}
+
+// Function to convert raw HX711 value to weight in grams, using a scale from lc_scale_from_factor()
+int32_t hx711_get_weight_g(int32_t raw_value, int32_t zero_offset, int64_t scale_q24) {
+    int64_t product = (int64_t)(raw_value - zero_offset) * scale_q24;
+    return (int32_t)((product + (1 << (LC_SCALE_Q - 1))) >> LC_SCALE_Q);
 }
 
 // Add these global variables after your defines
 static uint32_t tare_offset = 0;
-static float calibration_factor = 1.0f;
+static float calibration_factor = LC_MIN_SCALE_FACTOR;
+static int64_t scale_q24 = lc_scale_from_factor(LC_MIN_SCALE_FACTOR);
 
-// Calibration function - call this to zero/tare the scale
-void lc_calibrate_tare() {
-    printf("Calibrating tare (zero point)...\n");
-    printf("Remove all weight from the scale and press any key...\n");
-    getchar(); // Wait for user input
-    
-    // Take multiple readings and average them
-    uint32_t sum = 0;
-    int samples = 10;
-    
-    // Take multiple readings to get a stable tare offset
-    for (int i = 0; i < samples; i++) {
-        sum += hx711_read();
-        sleep_ms(100);
+// Switch to a new calibration factor, keeping the current one if the new one is unusable
+static bool lc_set_scale_factor(float scale_factor) {
+    if (!lc_scale_factor_valid(scale_factor)) {
+        return false;
     }
-    
-    tare_offset = sum / samples;
-    printf("Tare complete. Offset: %lu\n", tare_offset);
+    calibration_factor = scale_factor;
+    scale_q24 = lc_scale_from_factor(scale_factor);
+    return true;
 }
 
-// Calibration function - call this to set the scale factor
-void lc_calibrate_scale(float known_weight_kg) {
-    printf("Calibrating scale factor...\n");
-    printf("Place %.2f kg on the scale and press any key...\n", known_weight_kg);
-    getchar(); // Wait for user input
-    
-    // Take multiple readings and average them
-    uint32_t sum = 0;
-    int samples = 10;
-    
-    //
-    for (int i = 0; i < samples; i++) {
-        sum += hx711_read();
-        sleep_ms(100);
+// --- Calibration
+// Tare and scale calibration each average the next LC_CALIBRATION_SAMPLES conversions. They only start the
+// measurement; a one-shot task finishes it once the samples have arrived, so nothing blocks while waiting.
+#define LC_CALIBRATION_SAMPLES 10
+#define LC_CALIBRATION_POLL_US 50000
+
+enum LcCalibrationStep {
+    LC_CALIBRATION_IDLE,
+    LC_CALIBRATION_TARE,
+    LC_CALIBRATION_SCALE,
+};
+
+static LcCalibrationStep lc_calibration_step = LC_CALIBRATION_IDLE;
+static uint32_t lc_calibration_start = 0;
+static float lc_calibration_weight_kg = 0.0f;
+
+static void lc_calibration_task() {
+    if (lc_stream_count() - lc_calibration_start < LC_CALIBRATION_SAMPLES) {
+        sched_add_oneshot(lc_calibration_task, LC_CALIBRATION_POLL_US);
+        return;
+    }
+    int32_t average = 0;
+    lc_stream_average(LC_CALIBRATION_SAMPLES, &average);
+
+    if (lc_calibration_step == LC_CALIBRATION_TARE) {
+        tare_offset = (uint32_t)average;
+        LOG_INFO(MODULE_LOADCELL, "Tare complete. Offset: %lu", (unsigned long)tare_offset);
+    } else {
+        float factor = (float)(int32_t)((uint32_t)average - tare_offset) / lc_calibration_weight_kg;
+        if (!lc_set_scale_factor(factor)) {
+            LOG_WARNING(MODULE_LOADCELL, "Scale calibration rejected: factor %.2f, is the weight on the scale?", factor);
+            lc_calibration_step = LC_CALIBRATION_IDLE;
+            return;
+        }
+        LOG_INFO(MODULE_LOADCELL, "Scale calibration complete. Factor: %.2f", calibration_factor);
+    }
+    lc_calibration_step = LC_CALIBRATION_IDLE;
+
+    if (!lc_save_calibration()) {
+        LOG_WARNING(MODULE_LOADCELL, "Calibration could not be saved to flash");
     }
-    
-    // Calculate calibration factor
-    uint32_t loaded_reading = sum / samples;
-    calibration_factor = (float)(loaded_reading - tare_offset) / known_weight_kg;
-    
-    printf("Scale calibration complete. Factor: %.2f\n", calibration_factor);
+}
+
+static bool lc_calibration_begin(LcCalibrationStep step) {
+    if (lc_calibration_step != LC_CALIBRATION_IDLE) {
+        return false;
+    }
+    lc_stream_start();
+    lc_calibration_step = step;
+    lc_calibration_start = lc_stream_count();
+    sched_add_oneshot(lc_calibration_task, LC_CALIBRATION_POLL_US);
+    return true;
+}
+
+// Zero the scale with the next few readings. Remove all weight first. Returns false if a calibration is running.
+bool lc_calibrate_tare() {
+    return lc_calibration_begin(LC_CALIBRATION_TARE);
+}
+
+// Set the scale factor from the next few readings, with a known weight on the scale. Tare first.
+// Returns false if a calibration is running or the weight is not positive.
+bool lc_calibrate_scale(float known_weight_kg) {
+    if (!(known_weight_kg > 0.0f)) {
+        return false;
+    }
+    lc_calibration_weight_kg = known_weight_kg;
+    return lc_calibration_begin(LC_CALIBRATION_SCALE);
+}
+
+bool lc_calibration_busy() {
+    return lc_calibration_step != LC_CALIBRATION_IDLE;
+}
+
+// Restore the calibration saved by a previous boot. Returns false if flash holds no valid record, or one whose
+// factor is unusable.
+bool lc_load_calibration() {
+    CalibrationData data;
+    if (!calibration_load(&data) || !lc_set_scale_factor(data.calibration_factor)) {
+        return false;
+    }
+    tare_offset = (uint32_t)data.tare_offset;
+    return true;
+}
+
+// Persist the current calibration so the next boot can skip calibrating
+bool lc_save_calibration() {
+    CalibrationData data = {(int32_t)tare_offset, calibration_factor};
+    return calibration_save(&data);
 }
 
 // Updated weight reading function
-float lc_get_weight_kg() {
-    uint32_t raw_reading = hx711_read();
-    return (float)(raw_reading - tare_offset) / calibration_factor;
+// Uses the latest streamed sample when acquisition is running, otherwise waits for the next conversion.
+int32_t lc_get_weight_g() {
+    int32_t raw_reading;
+    if (!lc_streaming || lc_stream_latest(&raw_reading, 1) != 1) {
+        raw_reading = (int32_t)hx711_read();
+    }
+    return hx711_get_weight_g(raw_reading, (int32_t)tare_offset, scale_q24);
 }
 
-// Complete calibration function
-void lc_calibrate() {
-    printf("Load Cell Test Program\n");
-    printf("Press 'c' to calibrate, or any other key to start reading...\n");
-    
-    gpio_init(DISPLAY_CLK_PIN);
-    gpio_init(DISPLAY_DIO_PIN);
-    gpio_set_dir(DISPLAY_CLK_PIN, GPIO_OUT);
-    gpio_set_dir(DISPLAY_DIO_PIN, GPIO_OUT);
-    gpio_put(DISPLAY_CLK_PIN, 1);
-    gpio_put(DISPLAY_DIO_PIN, 1);
-     
-    char input = getchar();
-    if (input == 'c' || input == 'C') {
-        printf("Starting load cell calibration...\n");
-        
-        // Step 1: Tare (zero point)
-        lc_calibrate_tare();
-        
-        // Step 2: Scale factor with known weight
-        printf("Enter the weight of your calibration object in kg: ");
-        float known_weight;
-        scanf("%f", &known_weight);
-        
-        lc_calibrate_scale(known_weight);
-        
-        printf("Calibration complete!\n");
+// --- Stability detection and automatic zero tracking
+// The reading is stable once it has stayed inside a small band for a while. Automatic zero tracking, as in OIML R76,
+// treats a stable reading within half a display division of zero as drift and moves the zero offset to it, at most half
+// a division per second. Tracking arms once the reading has settled inside that half division, whether after boot, a
+// tare or an unload, and disarms as soon as the reading leaves it, so a load placed on the scale is never tracked away.
+#define LC_MOTION_BAND_G 2          // Readings within this band of the reference count as no motion
+#define LC_STABLE_TIME_MS 500       // How long the reading must stay in band to be stable
+#define LC_DIVISION_G 1             // Display division, d
+#define LC_ZERO_TRACK_PERIOD_MS 1000 // At most one correction, of up to 0.5 d, per period
+
+static bool lc_zero_tracking = true;
+static bool lc_zero_track_armed = false; // Set once the reading settles in the zero band, cleared when it leaves
+static uint32_t lc_zero_track_last_ms = 0;
+static int32_t lc_motion_ref_g = 0;
+static uint32_t lc_motion_since_ms = 0;
+static bool lc_stable = false;
+static bool lc_stable_pending = false;
+static int32_t lc_stable_weight_g = 0;
+
+// Half a display division in raw counts, for the current calibration
+static int32_t lc_zero_band_counts() {
+    return (int32_t)(fabsf(calibration_factor) * LC_DIVISION_G / 2000.0f);
+}
+
+// Update stability and zero tracking with a new filtered sample
+static void lc_track_stability(int32_t filtered_raw, uint32_t now_ms) {
+    int32_t zero_error = filtered_raw - (int32_t)tare_offset;
+    int32_t zero_band = lc_zero_band_counts();
+    bool in_zero_band = zero_error <= zero_band && zero_error >= -zero_band;
+    if (!in_zero_band) {
+        lc_zero_track_armed = false;
     }
 
-    sleep_ms(2000);
+    int32_t weight_g = hx711_get_weight_g(filtered_raw, (int32_t)tare_offset, scale_q24);
+    int32_t motion = weight_g - lc_motion_ref_g;
+    if (motion > LC_MOTION_BAND_G || motion < -LC_MOTION_BAND_G) {
+        lc_motion_ref_g = weight_g;
+        lc_motion_since_ms = now_ms;
+        lc_stable = false;
+        return;
+    }
+    if (now_ms - lc_motion_since_ms < LC_STABLE_TIME_MS) {
+        return;
+    }
 
-    while (1) {
-        float weight_kg = lc_get_weight_kg();
-        printf("Weight: %.3f kg\n", weight_kg);
-        
-        // Display weight on 7-segment display
-        display_weight(weight_kg);
-        
-        sleep_ms(500);
+    // Raise the stable weight event once per settled load
+    if (!lc_stable) {
+        lc_stable = true;
+        lc_stable_weight_g = weight_g;
+        lc_stable_pending = true;
+    }
+
+    if (!lc_zero_tracking || !in_zero_band) {
+        return;
+    }
+    // Settled at zero: the first correction comes a full period later
+    if (!lc_zero_track_armed) {
+        lc_zero_track_armed = true;
+        lc_zero_track_last_ms = now_ms;
+        return;
+    }
+    // The error is inside the band, so a correction per period keeps to 0.5 d/s
+    if (now_ms - lc_zero_track_last_ms >= LC_ZERO_TRACK_PERIOD_MS) {
+        tare_offset += zero_error;
+        lc_zero_track_last_ms = now_ms;
     }
 }
 
-// TM1637 7-segment display functions
-// Initialize the TM1637 display
-void tm1637_init() {
-    gpio_init(DISPLAY_CLK_PIN);
-    gpio_init(DISPLAY_DIO_PIN);
-    gpio_set_dir(DISPLAY_CLK_PIN, GPIO_OUT);
-    gpio_set_dir(DISPLAY_DIO_PIN, GPIO_OUT);
-    gpio_put(DISPLAY_CLK_PIN, 1);
-    gpio_put(DISPLAY_DIO_PIN, 1);
+// Enable or disable automatic zero tracking (enabled by default)
+void lc_set_zero_tracking(bool enabled) {
+    lc_zero_tracking = enabled;
 }
 
-// Start communication with the TM1637 display
-void tm1637_start() {
-    gpio_put(DISPLAY_DIO_PIN, 0);
-    sleep_us(50);
+// True while the reading has been steady for at least LC_STABLE_TIME_MS
+bool lc_is_stable() {
+    return lc_stable;
 }
 
-// Stop communication with the TM1637 display
-void tm1637_stop() {
-    gpio_put(DISPLAY_CLK_PIN, 0);
-    sleep_us(50);
-    gpio_put(DISPLAY_DIO_PIN, 0);
-    sleep_us(50);
-    gpio_put(DISPLAY_CLK_PIN, 1);
-    sleep_us(50);
-    gpio_put(DISPLAY_DIO_PIN, 1);
+// Returns true once each time the load settles, with the settled weight
+bool lc_take_stable_weight(int32_t *weight_g) {
+    if (!lc_stable_pending) {
+        return false;
+    }
+    lc_stable_pending = false;
+    *weight_g = lc_stable_weight_g;
+    return true;
 }
 
-// Write a byte to the TM1637 display
-void tm1637_write_byte(uint8_t data) {
-    for (int i = 0; i < 8; i++) {
-        gpio_put(DISPLAY_CLK_PIN, 0);
-        if (data & 0x01) {
-            gpio_put(DISPLAY_DIO_PIN, 1);
-        } else {
-            gpio_put(DISPLAY_DIO_PIN, 0);
-        }
-        sleep_us(50);
-        data >>= 1;
-        gpio_put(DISPLAY_CLK_PIN, 1);
-        sleep_us(50);
+// Run every sample collected since the last call through the filter. Returns true if there was new data.
+static uint32_t lc_poll_cursor = 0;
+bool lc_poll() {
+    int32_t samples[LC_STREAM_SIZE];
+    size_t count = lc_stream_read(&lc_poll_cursor, samples, LC_STREAM_SIZE);
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    for (size_t i = 0; i < count; i++) {
+        lc_track_stability(lc_filter_push(samples[i]), now_ms);
     }
-    
-    // ACK
-    gpio_put(DISPLAY_CLK_PIN, 0);
-    gpio_put(DISPLAY_DIO_PIN, 1);
-    sleep_us(50);
-    gpio_put(DISPLAY_CLK_PIN, 1);
-    sleep_us(50);
-    gpio_put(DISPLAY_CLK_PIN, 0);
+    return count > 0;
 }
 
-// Display weight on the TM1637 7-segment display
-void display_weight(float weight_kg) {
-    // Convert weight to display format (e.g., 1.234 kg -> show "1234")
-    int weight_display = (int)(fabs(weight_kg) * 1000); // Show as grams (multiply by 1000)
-    
+// Filtered weight, updated at the full HX711 rate by lc_poll()
+int32_t lc_get_filtered_weight_g() {
+    return hx711_get_weight_g(lc_filter_output(), (int32_t)tare_offset, scale_q24);
+}
+
+float lc_get_weight_kg() {
+    return lc_get_weight_g() / 1000.0f;
+}
+
+// Display weight in grams on the TM1637 7-segment display, using integer math only
+void display_weight_g(int32_t weight_g) {
     // Handle negative weights
-    bool negative = weight_kg < 0;
-    
-    // Digit encoding for 7-segment (0-9)
-    uint8_t digits[] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
-    uint8_t minus_sign = 0x40; // Minus sign encoding
-    
-    tm1637_start();
-    tm1637_write_byte(0x40); // Data command
-    tm1637_stop();
-    
-    tm1637_start();
-    tm1637_write_byte(0xC0); // Address command
-    
+    bool negative = weight_g < 0;
+    uint32_t weight_display = negative ? -(uint32_t)weight_g : (uint32_t)weight_g;
+
     // Display format: XXXX (no decimal points, showing weight in grams)
+    uint8_t segments[4];
+    segments[0] = tm1637_digit_segments[(weight_display / 1000) % 10]; // Thousands
+    segments[1] = tm1637_digit_segments[(weight_display / 100) % 10];  // Hundreds
+    segments[2] = tm1637_digit_segments[(weight_display / 10) % 10];   // Tens
+    segments[3] = tm1637_digit_segments[weight_display % 10];          // Units
     if (negative && weight_display < 10000) {
-        tm1637_write_byte(minus_sign);  // Show minus sign
-        tm1637_write_byte(digits[(weight_display / 100) % 10]); // Hundreds
-        tm1637_write_byte(digits[(weight_display / 10) % 10]);  // Tens
-        tm1637_write_byte(digits[weight_display % 10]);         // Units
-    } else {
-        tm1637_write_byte(digits[(weight_display / 1000) % 10]); // Thousands
-        tm1637_write_byte(digits[(weight_display / 100) % 10]);  // Hundreds
-        tm1637_write_byte(digits[(weight_display / 10) % 10]);   // Tens
-        tm1637_write_byte(digits[weight_display % 10]);          // Units
+        segments[0] = TM1637_SEG_MINUS; // Show minus sign in place of the thousands
     }
-    
-    tm1637_stop();
-    
-    tm1637_start();
-    tm1637_write_byte(0x8F); // Display control (brightness)
-    tm1637_stop();
+
+    tm1637_main_display.show_segments(segments);
+}
+
+// Display weight on the TM1637 7-segment display
+void display_weight(float weight_kg) {
+    display_weight_g((int32_t)lroundf(weight_kg * 1000)); // Show as grams (multiply by 1000)
 }
 
 // Function to send load cell data periodically
-// This function will be called in the main loop to send data every 15 seconds
+// Every filtered sample is batched; a reading is also sent once the load settles, with a heartbeat every 15 seconds
 static bool lc_send_initialized = false;
-static absolute_time_t last_send_time = {0};
-static const uint32_t SEND_INTERVAL_MS = 15000; // 15 seconds
+static uint32_t lc_send_interval_ms = 15000; // 15 seconds, or as set by the "interval" command
+// Scheduler periods are in microseconds and 32 bits wide, so the interval is kept well below 71 minutes
+#define LC_MIN_SEND_INTERVAL_MS 100
+#define LC_MAX_SEND_INTERVAL_MS 3600000
+
+// Scheduler tasks: lc_calibrate_send() drains the sample stream, the heartbeat covers periods with no new load
+#define LC_POLL_PERIOD_US 20000
+static sched_task_id lc_poll_task_id = -1;
+static sched_task_id lc_heartbeat_task_id = -1;
+
+// Send one weight reading to the Raspberry Pi
+static void lc_send_weight(int32_t weight_g, bool stable) {
+    telemetry_send_weight(weight_g, stable);
+
+    // Display locally, formatting kg with three decimals from the integer grams to avoid soft-float printf
+    const char *sign = weight_g < 0 ? "-" : "";
+    uint32_t abs_g = weight_g < 0 ? -(uint32_t)weight_g : (uint32_t)weight_g;
+    LOG_INFO(MODULE_LOADCELL, "Weight: %s%lu.%03lu kg", sign, (unsigned long)(abs_g / 1000), (unsigned long)(abs_g % 1000));
+}
 
 // Function to send load cell data over UART
 void lc_calibrate_send() {
     // One-time initialization
     if (!lc_send_initialized) {
         printf("Load Cell Test Program\n");
-        printf("Press 'c' to calibrate, or any other key to start reading...\n");
         
         // Initialize display
-        gpio_init(DISPLAY_CLK_PIN);
-        gpio_init(DISPLAY_DIO_PIN);
-        gpio_set_dir(DISPLAY_CLK_PIN, GPIO_OUT);
-        gpio_set_dir(DISPLAY_DIO_PIN, GPIO_OUT);
-        gpio_put(DISPLAY_CLK_PIN, 1);
-        gpio_put(DISPLAY_DIO_PIN, 1);
+        tm1637_main_display.init();
         
-        // Initialize UART
-        char input = getchar();
-        if (input == 'c' || input == 'C') {
-            printf("Starting load cell calibration...\n");
-            
-            // Step 1: Tare (zero point)
-            lc_calibrate_tare();
-            
-            // Step 2: Scale factor with known weight
-            printf("Enter the weight of your calibration object in kg: ");
-            float known_weight;
-            scanf("%f", &known_weight);
-            
-            lc_calibrate_scale(known_weight);
-            
-            printf("Calibration complete!\n");
+        // Start collecting samples so calibration and reporting use data that is already buffered
+        lc_stream_start();
+
+        // Use the stored calibration if there is one, so measuring starts straight away
+        if (lc_load_calibration()) {
+            LOG_INFO(MODULE_LOADCELL, "Loaded stored calibration. Offset: %ld, factor: %.2f", (long)(int32_t)tare_offset,
+                     calibration_factor);
+        } else {
+            LOG_WARNING(MODULE_LOADCELL, "Not calibrated: send 'tare', then 'calibrate <kg>' with the weight on");
         }
 
         printf("Starting weight measurements and UART transmission...\n");
-        printf("Sending readings every 15 seconds...\n");
+        printf("Sending readings as they change, and at least every %lu seconds...\n",
+               (unsigned long)(lc_send_interval_ms / 1000));
         
-        // Initialize last send time
-        last_send_time = get_absolute_time();
         lc_send_initialized = true;
         return; // Exit to allow button checking
     }
     
-    // Check if it's time for next measurement and transmission
-    absolute_time_t now = get_absolute_time();
-    if (absolute_time_diff_us(last_send_time, now) >= SEND_INTERVAL_MS * 1000) {
-        float weight_kg = lc_get_weight_kg();
-        
-        // Display locally
-        printf("Weight: %.3f kg\n", weight_kg);
-        
-        // Send JSON data to Raspberry Pi
-        char json_buffer[128];
-        snprintf(json_buffer, sizeof(json_buffer), 
-                "{\"weight\":%.3f,\"unit\":\"kg\",\"timestamp\":%lu}\n", 
-                weight_kg, to_ms_since_boot(get_absolute_time()));
-        uart_puts(UART_ID, json_buffer);
-        
-        printf("Sent to Pi: %s", json_buffer);
-        
-        // Display weight on 7-segment display
-        display_weight(weight_kg);
-        
-        printf("Next reading in 15 seconds...\n");
-        last_send_time = now;
+    // Keep the filter and display up to date at the full HX711 rate, and batch every sample for the Pi
+    static int32_t displayed_g = INT32_MIN;
+    if (lc_poll()) {
+        int32_t filtered_g = lc_get_filtered_weight_g();
+        telemetry_batch_add(CHANNEL_WEIGHT, filtered_g);
+        if (filtered_g != displayed_g) {
+            display_weight_g(filtered_g);
+            displayed_g = filtered_g;
+        }
     }
-}
\ No newline at end of file
+
+    // Flag the reading as soon as the load settles, and push the heartbeat back a full interval
+    int32_t weight_g;
+    if (lc_take_stable_weight(&weight_g)) {
+        lc_send_weight(weight_g, true);
+        sched_reschedule(lc_heartbeat_task_id, lc_send_interval_ms * 1000);
+    }
+}
+
+// Send the filtered weight when no load has settled for lc_send_interval_ms
+static void lc_heartbeat() {
+    // Report the filtered weight rather than waiting for a new conversion
+    lc_send_weight(lc_get_filtered_weight_g(), lc_is_stable());
+}
+
+// Register the polling and heartbeat tasks with the scheduler
+void lc_start_tasks() {
+    if (lc_poll_task_id >= 0) {
+        return;
+    }
+    lc_calibrate_send(); // One-time initialisation
+    lc_poll_task_id = sched_add_periodic(lc_calibrate_send, LC_POLL_PERIOD_US);
+    lc_heartbeat_task_id = sched_add_periodic(lc_heartbeat, lc_send_interval_ms * 1000);
+}
+
+void lc_stop_tasks() {
+    sched_cancel(lc_poll_task_id);
+    sched_cancel(lc_heartbeat_task_id);
+    lc_poll_task_id = -1;
+    lc_heartbeat_task_id = -1;
+}
+// Change how often the heartbeat reading is sent. The interval is clamped to LC_MIN_SEND_INTERVAL_MS to
+// LC_MAX_SEND_INTERVAL_MS.
+void lc_set_send_interval(uint32_t interval_ms) {
+    if (interval_ms < LC_MIN_SEND_INTERVAL_MS) {
+        interval_ms = LC_MIN_SEND_INTERVAL_MS;
+    } else if (interval_ms > LC_MAX_SEND_INTERVAL_MS) {
+        interval_ms = LC_MAX_SEND_INTERVAL_MS;
+    }
+    lc_send_interval_ms = interval_ms;
+    if (lc_heartbeat_task_id >= 0) {
+        sched_cancel(lc_heartbeat_task_id);
+        lc_heartbeat_task_id = sched_add_periodic(lc_heartbeat, lc_send_interval_ms * 1000);
+    }
+}
+
+// --- Console commands
+static void lc_command_tare(int argc, char **argv) {
+    if (lc_calibrate_tare()) {
+        printf("OK taring\n");
+    } else {
+        printf("ERR calibration already running\n");
+    }
+}
+
+static void lc_command_calibrate(int argc, char **argv) {
+    float known_weight_kg = argc == 2 ? strtof(argv[1], nullptr) : 0.0f;
+    if (!(known_weight_kg > 0.0f)) {
+        printf("ERR usage: calibrate <kg>\n");
+    } else if (lc_calibrate_scale(known_weight_kg)) {
+        printf("OK calibrating\n");
+    } else {
+        printf("ERR calibration already running\n");
+    }
+}
+
+static void lc_command_interval(int argc, char **argv) {
+    // Check the range before narrowing, so an out-of-range number can't wrap into an accepted one
+    char *end = nullptr;
+    unsigned long interval_ms = argc == 2 && argv[1][0] != '-' ? strtoul(argv[1], &end, 10) : 0;
+    if (end == argv[1] || (end != nullptr && *end != '\0') || interval_ms < LC_MIN_SEND_INTERVAL_MS ||
+        interval_ms > LC_MAX_SEND_INTERVAL_MS) {
+        printf("ERR usage: interval <ms>, %u to %u\n", LC_MIN_SEND_INTERVAL_MS, LC_MAX_SEND_INTERVAL_MS);
+        return;
+    }
+    lc_set_send_interval((uint32_t)interval_ms);
+    printf("OK interval %lu\n", (unsigned long)interval_ms);
+}
+
+// Add the load cell's commands to the command channel
+void lc_register_commands() {
+    command_register("tare", "tare", lc_command_tare);
+    command_register("calibrate", "calibrate <kg>", lc_command_calibrate);
+    command_register("interval", "interval <ms>", lc_command_interval);
+}
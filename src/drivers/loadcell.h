@@ -1,30 +1,102 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+/// Filters available for live load cell readings.
+enum LcFilterType {
+    LC_FILTER_NONE,
+    LC_FILTER_MOVING_AVERAGE,
+    LC_FILTER_MEDIAN,
+    LC_FILTER_IIR,
+};
+
+#define LC_FILTER_MAX_WINDOW 16
+
+/// Filter stage configuration.
+struct LcFilterConfig {
+    LcFilterType type;
+    size_t window;             ///< Samples in the moving average or median window (1 to LC_FILTER_MAX_WINDOW).
+    int iir_shift;             ///< IIR smoothing: each sample moves the output by 1/2^iir_shift of the error.
+    int32_t outlier_threshold; ///< Raw counts from the current output beyond which a sample is an outlier (0 = off).
+    uint32_t max_rejected;     ///< Consecutive outliers to drop before accepting them as a real step change.
+};
+
 void hx711_init();
 
 uint32_t hx711_read();
 
+bool hx711_try_read(int32_t *value);
+
+void lc_stream_start();
+
+void lc_stream_stop();
+
+uint32_t lc_stream_count();
+
+size_t lc_stream_latest(int32_t *out, size_t n);
+
+bool lc_stream_average(size_t n, int32_t *average);
+
+size_t lc_stream_read(uint32_t *cursor, int32_t *out, size_t max);
+
+void lc_filter_configure(const LcFilterConfig *config);
+
+void lc_filter_reset();
+
+int32_t lc_filter_push(int32_t raw);
+
+int32_t lc_filter_output();
+
+uint32_t lc_filter_rejected_count();
+
+bool lc_poll();
+
+void lc_set_zero_tracking(bool enabled);
+
+bool lc_is_stable();
+
+bool lc_take_stable_weight(int32_t *weight_g);
+
+int32_t lc_get_filtered_weight_g();
+
 float hx711_get_weight_kg(uint32_t raw_value, uint32_t zero_offset, float scale_factor);
 
-static uint32_t tare_offset = 0;
-static float calibration_factor = 1.0f;
+/// True if `scale_factor` (counts per kg) is far enough from zero to convert readings with.
+bool lc_scale_factor_valid(float scale_factor);
 
-void lc_calibrate_tare();
+int64_t lc_scale_from_factor(float scale_factor);
 
-void lc_calibrate_scale(float known_weight_kg);
+int32_t hx711_get_weight_g(int32_t raw_value, int32_t zero_offset, int64_t scale_q24);
 
-float lc_get_weight_kg();
+/// Start zeroing the scale from the next few readings; the result is applied and saved once they arrive.
+/// Returns false if a calibration is already running.
+bool lc_calibrate_tare();
 
-void lc_calibrate();
+/// Start computing the scale factor with `known_weight_kg` on the scale, like lc_calibrate_tare().
+bool lc_calibrate_scale(float known_weight_kg);
 
-void tm1637_init();
+bool lc_calibration_busy();
 
-void tm1637_start();
+bool lc_load_calibration();
 
-void tm1637_stop();
+bool lc_save_calibration();
 
-void tm1637_write_byte(uint8_t data);
+float lc_get_weight_kg();
+
+int32_t lc_get_weight_g();
 
 void display_weight(float weight_kg);
 
-void lc_calibrate_send();
\ No newline at end of file
+void display_weight_g(int32_t weight_g);
+
+void lc_calibrate_send();
+
+void lc_start_tasks();
+
+void lc_stop_tasks();
+
+void lc_set_send_interval(uint32_t interval_ms);
+
+/// Add the tare, calibrate and interval commands to the command channel.
+void lc_register_commands();
@@ -1,46 +1,387 @@
 // Logging system, using the style that state is global in the C file.
 
 #include <stdio.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "pico/time.h"
+#include "pico/platform.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "drivers/uart_tx.h"
 #include "logging.h"
+#include "drivers/ring_buffer.h"
+#include "drivers/scheduler.h"
+
+#ifndef LOG_BINARY
+#define LOG_BINARY 0
+#endif
 
 // --- Device driver internal state:
 
-/// Drop messages whose level is below this threshold.
-static LogLevel maxLogLevel = LogLevel::INFORMATION;
+/// Drop messages whose level is below their module's threshold.
+static LogLevel moduleLogLevels[MODULE_COUNT] = {
+    LogLevel::INFORMATION,
+    LogLevel::INFORMATION,
+    LogLevel::INFORMATION,
+    LogLevel::INFORMATION,
+};
+
+/// A deferred message as captured by logDeferred().
+struct LogRecord {
+    uint64_t time_us;
+    const char *fmt;
+    uint8_t level;
+    uint8_t count;
+    LogArg args[LOG_MAX_ARGS];
+};
+
+// One ring per core. Interrupts are masked while a record is pushed, so the task and interrupt handlers on a core take
+// turns as its single producer; the drain task on one core is the single consumer of both rings.
+#define LOG_RING_SIZE 32
+static RingBuffer<LogRecord, LOG_RING_SIZE> logRings[NUM_CORES];
+static volatile uint32_t logDropped[NUM_CORES];
+
+// The drain task prints a few records per run, so a burst of messages cannot hold up the other tasks
+#define LOG_DRAIN_PERIOD_US 10000
+#define LOG_DRAIN_BATCH 8
+static sched_task_id logDrainTaskId = -1;
 
 // --- Device driver functions
 void setLogLevel(LogLevel newLevel)
 {
-    maxLogLevel = newLevel;
+    for (int module = 0; module < MODULE_COUNT; module++) {
+        moduleLogLevels[module] = newLevel;
+    }
+}
+
+void setModuleLogLevel(LogModule module, LogLevel newLevel)
+{
+    moduleLogLevels[module] = newLevel;
+}
+
+bool logEnabled(LogModule module, LogLevel level)
+{
+    return level >= moduleLogLevels[module];
+}
+
+// Convert a level to a string
+static const char *logLevelName(LogLevel level)
+{
+    switch (level) {
+        case LogLevel::VERBOSE:
+            return "Verbose";
+        case LogLevel::INFORMATION:
+            return "Information";
+        case LogLevel::WARNING:
+            return "Warning";
+        case LogLevel::ERROR:
+            return "Error";
+    };
+    return "?";
+}
+
+// Print a message with its timestamp and level
+static void logPrint(uint32_t time, LogLevel level, const char *msg)
+{
+    uint32_t time_sec = time / 1000;
+    uint32_t time_decimal = (time % 1000);
+    printf("[%u.%03u %s]: %s\n", time_sec, time_decimal, logLevelName(level), msg);
 }
 
 void log(LogLevel level, const char *msg)
 {
     // Should we show this message?
-    if (level < maxLogLevel) {
+    if (!logEnabled(MODULE_MAIN, level)) {
         return;
     }
 
     // Get the time since boot
     uint32_t time = to_ms_since_boot(get_absolute_time());
-    uint32_t time_sec = time / 1000;
-    uint32_t time_decimal = (time % 1000);
+    logPrint(time, level, msg);
+}
 
-    // Convert the level to a string
-    const char *levelStr;
-    switch (level) {
-        case LogLevel::INFORMATION:
-            levelStr = "Information";
-            break;
-        case LogLevel::WARNING:
-            levelStr = "Warning";
+bool logDeferredArgs(LogModule module, LogLevel level, const char *fmt, const LogArg *args, size_t count)
+{
+    if (!logEnabled(module, level)) {
+        return true;
+    }
+
+    LogRecord record;
+    record.time_us = time_us_64();
+    record.fmt = fmt;
+    record.level = level;
+    record.count = count < LOG_MAX_ARGS ? count : LOG_MAX_ARGS;
+    if (record.count > 0) {
+        memcpy(record.args, args, record.count * sizeof(LogArg));
+    }
+
+    unsigned int core = get_core_num();
+    uint32_t irq_status = save_and_disable_interrupts();
+    bool queued = logRings[core].push(record);
+    if (!queued) {
+        logDropped[core] = logDropped[core] + 1; // Interrupts are off and only this core writes its counter
+    }
+    restore_interrupts(irq_status);
+    return queued;
+}
+
+#if !LOG_BINARY
+// Format one conversion, `spec` being the text from '%' up to and including the conversion character. The length
+// modifier the caller wrote is replaced by the one matching the captured argument, and the argument is converted if it
+// does not suit the conversion.
+static int logFormatArg(char *out, size_t size, const char *spec, size_t spec_len, const LogArg *arg)
+{
+    char conv = spec[spec_len - 1];
+
+    // Copy the flags, width and precision, dropping any length modifier
+    char f[16];
+    size_t n = 0;
+    for (size_t i = 0; i < spec_len - 1 && n < sizeof(f) - 4; i++) {
+        if (strchr("hljztL", spec[i]) == nullptr) {
+            f[n++] = spec[i];
+        }
+    }
+
+    if (arg == nullptr) {
+        return snprintf(out, size, "(missing)");
+    }
+    if (conv == 's') {
+        f[n++] = 's';
+        f[n] = '\0';
+        return snprintf(out, size, f, arg->type == LogArg::STRING && arg->s != nullptr ? arg->s : "(?)");
+    }
+    if (conv == 'p') {
+        return snprintf(out, size, "%p", arg->type == LogArg::POINTER ? arg->p : nullptr);
+    }
+    if (strchr("fFeEgGaA", conv) != nullptr) {
+        double v;
+        switch (arg->type) {
+            case LogArg::INT: v = arg->i; break;
+            case LogArg::UINT: v = arg->u; break;
+            case LogArg::INT64: v = arg->i64; break;
+            case LogArg::UINT64: v = arg->u64; break;
+            case LogArg::DOUBLE: v = arg->d; break;
+            default: v = 0; break;
+        }
+        f[n++] = conv;
+        f[n] = '\0';
+        return snprintf(out, size, f, v);
+    }
+
+    // Integer conversions are always printed from a 64-bit value
+    long long v;
+    switch (arg->type) {
+        case LogArg::INT: v = arg->i; break;
+        case LogArg::UINT: v = arg->u; break;
+        case LogArg::INT64: v = arg->i64; break;
+        case LogArg::UINT64: v = (long long)arg->u64; break;
+        case LogArg::DOUBLE: v = (long long)arg->d; break;
+        default: v = (long long)(uintptr_t)arg->p; break;
+    }
+    if (conv == 'c') {
+        f[n++] = 'c';
+        f[n] = '\0';
+        return snprintf(out, size, f, (int)v);
+    }
+    f[n++] = 'l';
+    f[n++] = 'l';
+    f[n++] = conv;
+    f[n] = '\0';
+    return snprintf(out, size, f, v);
+}
+
+// Expand a record's format string into `out`
+static void logFormat(char *out, size_t size, const LogRecord *record)
+{
+    const char *p = record->fmt;
+    size_t used = 0;
+    size_t arg = 0;
+    while (*p != '\0' && used + 1 < size) {
+        if (*p != '%') {
+            out[used++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[used++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Find the conversion character
+        size_t len = 1;
+        while (p[len] != '\0' && strchr("diouxXcspfFeEgGaA", p[len]) == nullptr) {
+            len++;
+        }
+        if (p[len] == '\0') {
             break;
-        case LogLevel::ERROR:
-            levelStr = "Error";
+        }
+        len++;
+
+        const LogArg *a = arg < record->count ? &record->args[arg] : nullptr;
+        arg++;
+        int written = logFormatArg(out + used, size - used, p, len, a);
+        if (written > 0) {
+            used += (size_t)written < size - used ? written : size - used - 1;
+        }
+        p += len;
+    }
+    out[used] = '\0';
+}
+
+#else
+// --- Binary encoding
+// Each record is sent as:
+//   0xFE marker
+//   varint  message id << 3 | absolute timestamp flag << 2 | level
+//   varint  microseconds since the previous record, or since boot when the flag is set
+//   varint  argument count | type of argument i << (3 + 3 * i)
+//   arguments: integers as (zigzag) varints, floating point as a little-endian float, strings as a length and bytes
+// The message id is a hash of the format string; tools/log_extract.py builds the table that tools/logdecode uses to
+// turn the ids back into text. Any other bytes in the stream are printf output and are passed through by the decoder.
+#define LOG_BINARY_MARKER 0xFE
+#define LOG_BINARY_KEYFRAME 64 // Send an absolute timestamp this often, so a decoder can join mid-stream
+#define LOG_BINARY_MAX_STRING 32
+
+static uint64_t logLastTimeUs = 0;
+static uint32_t logRecordsSinceKeyframe = LOG_BINARY_KEYFRAME;
+
+// 16-bit message id: FNV-1a of the format string, folded
+static uint16_t logMessageId(const char *fmt)
+{
+    uint32_t h = 2166136261u;
+    for (const char *p = fmt; *p != '\0'; p++) {
+        h ^= (uint8_t)*p;
+        h *= 16777619u;
+    }
+    return (uint16_t)((h >> 16) ^ h);
+}
+
+static size_t logPutVarint(uint8_t *out, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint64_t logZigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+// Encode a record into `out`, which must hold at least LOG_BINARY_MAX_RECORD bytes. Returns the length.
+#define LOG_BINARY_MAX_RECORD (1 + 3 * 10 + LOG_MAX_ARGS * (10 + LOG_BINARY_MAX_STRING))
+static size_t logEncode(uint8_t *out, const LogRecord *record)
+{
+    size_t n = 0;
+    out[n++] = LOG_BINARY_MARKER;
+
+    bool absolute = ++logRecordsSinceKeyframe >= LOG_BINARY_KEYFRAME || record->time_us < logLastTimeUs;
+    if (absolute) {
+        logRecordsSinceKeyframe = 0;
+    }
+    uint64_t time = absolute ? record->time_us : record->time_us - logLastTimeUs;
+    logLastTimeUs = record->time_us;
+
+    n += logPutVarint(out + n, (uint64_t)logMessageId(record->fmt) << 3 | (absolute ? 4 : 0) | (record->level & 3));
+    n += logPutVarint(out + n, time);
+
+    uint32_t types = record->count;
+    for (size_t i = 0; i < record->count; i++) {
+        types |= (uint32_t)record->args[i].type << (3 + 3 * i);
+    }
+    n += logPutVarint(out + n, types);
+
+    for (size_t i = 0; i < record->count; i++) {
+        const LogArg *arg = &record->args[i];
+        switch (arg->type) {
+            case LogArg::INT: n += logPutVarint(out + n, logZigzag(arg->i)); break;
+            case LogArg::UINT: n += logPutVarint(out + n, arg->u); break;
+            case LogArg::INT64: n += logPutVarint(out + n, logZigzag(arg->i64)); break;
+            case LogArg::UINT64: n += logPutVarint(out + n, arg->u64); break;
+            case LogArg::POINTER: n += logPutVarint(out + n, (uintptr_t)arg->p); break;
+            case LogArg::DOUBLE: {
+                float f = (float)arg->d;
+                memcpy(out + n, &f, 4);
+                n += 4;
+                break;
+            }
+            case LogArg::STRING: {
+                const char *str = arg->s != nullptr ? arg->s : "";
+                size_t len = strnlen(str, LOG_BINARY_MAX_STRING);
+                n += logPutVarint(out + n, len);
+                memcpy(out + n, str, len);
+                n += len;
+                break;
+            }
+        }
+    }
+    return n;
+}
+#endif
+
+size_t logDrain(size_t max_records)
+{
+    size_t printed = 0;
+    while (printed < max_records) {
+        // Print the oldest record from either core, so the output stays in time order
+        int oldest = -1;
+        LogRecord record;
+        uint64_t oldest_us = 0;
+        for (int core = 0; core < NUM_CORES; core++) {
+            if (logRings[core].peek(&record) && (oldest < 0 || record.time_us < oldest_us)) {
+                oldest = core;
+                oldest_us = record.time_us;
+            }
+        }
+        if (oldest < 0) {
             break;
-        
-    };
-    printf("[%u.%03u %s]: %s\n", time_sec, time_decimal, levelStr, msg);
+        }
+        logRings[oldest].pop(&record);
+
+#if LOG_BINARY
+        uint8_t encoded[LOG_BINARY_MAX_RECORD];
+        size_t len = logEncode(encoded, &record);
+        uart_tx_write(encoded, len);
+#else
+        char msg[128];
+        logFormat(msg, sizeof(msg), &record);
+        logPrint((uint32_t)(record.time_us / 1000), (LogLevel)record.level, msg);
+#endif
+        printed++;
+    }
+
+    // Report drops once they have been seen, rather than from inside logDeferred()
+    static uint32_t reported_drops = 0;
+    uint32_t drops = logDroppedCount();
+    if (drops != reported_drops) {
+        printf("[log]: %lu messages dropped\n", (unsigned long)(drops - reported_drops));
+        reported_drops = drops;
+    }
+    return printed;
+}
+
+static void logDrainTask()
+{
+    logDrain(LOG_DRAIN_BATCH);
+}
+
+void logStartDrainTask()
+{
+    if (logDrainTaskId >= 0) {
+        return;
+    }
+    logDrainTaskId = sched_add_periodic(logDrainTask, LOG_DRAIN_PERIOD_US);
+}
+
+uint32_t logDroppedCount()
+{
+    uint32_t total = 0;
+    for (int core = 0; core < NUM_CORES; core++) {
+        total += logDropped[core];
+    }
+    return total;
 }
@@ -1,14 +1,121 @@
 #pragma once 
 
+#include <stddef.h>
+#include <stdint.h>
+
 /// Represents the priority of a log message.
 enum LogLevel {
+    VERBOSE,
     INFORMATION,
     WARNING,
     ERROR,
 };
 
-/// Set the log level. Messages with a level below this threshold will be discarded.
+/// The part of the firmware a message comes from. Each module has its own runtime log level.
+enum LogModule {
+    MODULE_MAIN,
+    MODULE_LOADCELL,
+    MODULE_IR,
+    MODULE_ULTRASONIC,
+    MODULE_COUNT,
+};
+
+/// Set the log level of every module. Messages with a level below this threshold will be discarded.
 void setLogLevel(LogLevel newLevel);
 
-/// Log a new message.
+/// Set the log level of one module.
+void setModuleLogLevel(LogModule module, LogLevel newLevel);
+
+/// True if a message from `module` at `level` would be kept.
+bool logEnabled(LogModule module, LogLevel level);
+
+/// Log a new message. It belongs to MODULE_MAIN.
 void log(LogLevel level, const char *msg);
+
+// --- Deferred logging
+// logDeferred() only copies the format pointer and arguments into a ring buffer; formatting and output happen later in
+// the drain task. It is safe to call from interrupt handlers and from either core.
+// With LOG_BINARY=1 the drain task sends each record as a message id and encoded arguments instead of text; decode the
+// output with tools/logdecode and the format table generated by tools/log_extract.py.
+
+/// Maximum number of arguments to a deferred log message.
+#define LOG_MAX_ARGS 4
+
+/// One captured argument of a deferred log message.
+struct LogArg {
+    enum Type : uint8_t { INT, UINT, INT64, UINT64, DOUBLE, STRING, POINTER };
+    Type type;
+    union {
+        int32_t i;
+        uint32_t u;
+        int64_t i64;
+        uint64_t u64;
+        double d;
+        const char *s;
+        const void *p;
+    };
+};
+
+inline LogArg logArg(int v) { LogArg a; a.type = LogArg::INT; a.i = v; return a; }
+inline LogArg logArg(unsigned int v) { LogArg a; a.type = LogArg::UINT; a.u = v; return a; }
+inline LogArg logArg(long v) { LogArg a; a.type = LogArg::INT64; a.i64 = v; return a; }
+inline LogArg logArg(unsigned long v) { LogArg a; a.type = LogArg::UINT64; a.u64 = v; return a; }
+inline LogArg logArg(long long v) { LogArg a; a.type = LogArg::INT64; a.i64 = v; return a; }
+inline LogArg logArg(unsigned long long v) { LogArg a; a.type = LogArg::UINT64; a.u64 = v; return a; }
+inline LogArg logArg(double v) { LogArg a; a.type = LogArg::DOUBLE; a.d = v; return a; }
+inline LogArg logArg(const char *v) { LogArg a; a.type = LogArg::STRING; a.s = v; return a; }
+inline LogArg logArg(const void *v) { LogArg a; a.type = LogArg::POINTER; a.p = v; return a; }
+
+/// Queue a log record made of already captured arguments. Returns false if the record was dropped.
+bool logDeferredArgs(LogModule module, LogLevel level, const char *fmt, const LogArg *args, size_t count);
+
+/// Queue a printf-style message from `module` without formatting it. `fmt` and any %s arguments must stay valid until
+/// the message is drained, so pass string literals. Width and precision must be written in the format, not passed as
+/// `*` arguments.
+template <typename... Args>
+bool logDeferredModule(LogModule module, LogLevel level, const char *fmt, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many arguments for a deferred log message");
+    if constexpr (sizeof...(Args) == 0) {
+        return logDeferredArgs(module, level, fmt, nullptr, 0);
+    } else {
+        LogArg captured[] = {logArg(args)...};
+        return logDeferredArgs(module, level, fmt, captured, sizeof...(Args));
+    }
+}
+
+/// Queue a printf-style message from MODULE_MAIN without formatting it.
+template <typename... Args>
+bool logDeferred(LogLevel level, const char *fmt, Args... args) {
+    return logDeferredModule(MODULE_MAIN, level, fmt, args...);
+}
+
+// --- Log macros
+// Messages below LOG_COMPILE_LEVEL (set from CMake) are removed at compile time, arguments and all. The rest are
+// filtered by their module's runtime level before anything is captured.
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL VERBOSE
+#endif
+
+#define LOG_AT(module, level, fmt, ...)                                                                                \
+    do {                                                                                                               \
+        if constexpr ((level) >= (LOG_COMPILE_LEVEL)) {                                                                \
+            if (logEnabled(module, level)) {                                                                           \
+                logDeferredModule(module, level, fmt, ##__VA_ARGS__);                                                  \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (0)
+
+#define LOG_VERBOSE(module, fmt, ...) LOG_AT(module, VERBOSE, fmt, ##__VA_ARGS__)
+#define LOG_INFO(module, fmt, ...) LOG_AT(module, INFORMATION, fmt, ##__VA_ARGS__)
+#define LOG_WARNING(module, fmt, ...) LOG_AT(module, WARNING, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(module, fmt, ...) LOG_AT(module, ERROR, fmt, ##__VA_ARGS__)
+
+/// Format and print up to `max_records` queued messages, oldest first. Call from one core only. Returns the number
+/// printed.
+size_t logDrain(size_t max_records);
+
+/// Register the drain task with the scheduler of the calling core.
+void logStartDrainTask();
+
+/// Number of deferred messages dropped because the ring was full.
+uint32_t logDroppedCount();
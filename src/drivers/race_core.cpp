@@ -0,0 +1,79 @@
+// Runs the IR lap timer and its displays on core 1, using the style that state is global in the C file.
+//
+// Core 0 sends mode changes, and core 1 sends acknowledgements and lap events back, through single-producer,
+// single-consumer queues in shared RAM. Each push is followed by SEV, so the other core wakes from WFE. Core 1 never
+// waits on core 0. Core 0 waits for each mode change to be acknowledged, because the two cores take turns drawing on
+// the main display: once a stop is acknowledged, core 1 no longer touches it.
+//
+// The SIO inter-core FIFOs are not used: they belong to the SDK's multicore lockout, whose interrupt handler on core 1
+// swallows every word in the FIFO, and core 0 uses it to pause core 1 while calibration is written to flash.
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "drivers/IR.h"
+#include "drivers/ring_buffer.h"
+#include "drivers/scheduler.h"
+#include "drivers/race_core.h"
+
+// --- Internal state:
+static RingBuffer<bool, 4> race_commands; // Core 0 to core 1: true to start the lap timer, false to stop it
+static RingBuffer<bool, 4> race_acks;     // Core 1 to core 0: each command, once it has been applied
+static RingBuffer<uint32_t, 8> race_laps; // Core 1 to core 0: lap times in ms
+static volatile uint32_t race_laps_dropped = 0;
+
+// Core 1: forward a completed lap to core 0
+static void race_post_lap(uint32_t lap_ms) {
+    // Never stall the lap timer: if core 0 is behind, drop the event and count it
+    if (race_laps.push(lap_ms)) {
+        __sev();
+    } else {
+        race_laps_dropped = race_laps_dropped + 1; // Only core 1 writes it
+    }
+}
+
+// Core 1 entry point: apply mode changes from core 0, then run the IR tasks on this core's scheduler
+static void race_core1_main() {
+    // Let core 0 pause this core while it writes calibration to flash
+    multicore_lockout_victim_init();
+    ir_set_lap_callback(race_post_lap);
+
+    while (true) {
+        bool active;
+        while (race_commands.pop(&active)) {
+            if (active) {
+                ir_start_tasks();
+            } else {
+                ir_stop_tasks();
+            }
+            race_acks.push(active);
+            __sev(); // Core 0 is waiting for the acknowledgement
+        }
+        // The SEV that follows a command from core 0 wakes this core from its WFE
+        sched_run_pending();
+        sched_wait();
+    }
+}
+
+void race_core_launch() {
+    multicore_launch_core1(race_core1_main);
+}
+
+void race_core_set_active(bool active) {
+    // Only one command is ever outstanding, since each waits for its acknowledgement
+    race_commands.push(active);
+    __sev();
+    bool applied;
+    while (!race_acks.pop(&applied)) {
+        __wfe();
+    }
+}
+
+bool race_core_poll_lap(uint32_t *lap_ms) {
+    return race_laps.pop(lap_ms);
+}
+
+uint32_t race_core_laps_dropped() {
+    return race_laps_dropped;
+}
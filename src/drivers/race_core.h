@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Start core 1, which then waits for race mode to be switched on.
+void race_core_launch();
+
+/// Start or stop the IR lap timer and its displays on core 1. Returns once core 1 has applied the change, so after
+/// a stop core 0 can draw on the main display again.
+void race_core_set_active(bool active);
+
+/// Fetch the next lap time (in ms) reported by core 1. Returns false if there is none waiting.
+bool race_core_poll_lap(uint32_t *lap_ms);
+
+/// Number of lap events dropped because core 0 was not keeping up with the lap queue.
+uint32_t race_core_laps_dropped();
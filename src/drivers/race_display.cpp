@@ -0,0 +1,118 @@
+// Race status on a WS2812 strip, using the style that state is global in the C file.
+//
+// The strip is split in two: a speed bar fed by the ultrasonic speed estimate, running green to red as the car gets
+// faster, and a lap counter at the far end. The LED for the latest lap shows how it compares with the session's best
+// lap, the one to beat: green for a new best, red for slower. A scheduler task redraws the frame and hands it to the
+// DMA, so a refresh costs the CPU a few microseconds however long the strip is.
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "drivers/led_strip.h"
+#include "drivers/race_display.h"
+#include "drivers/scheduler.h"
+#include "drivers/speed_estimator.h"
+
+#define RACE_DISPLAY_PIN 22
+#define RACE_DISPLAY_LEDS 60
+#define RACE_DISPLAY_LAP_LEDS 10 // At the far end of the strip; the rest is the speed bar
+#define RACE_DISPLAY_PERIOD_US 50000 // 20 frames a second
+#define RACE_DISPLAY_BLANK_RETRY_US 1000
+#define RACE_DISPLAY_FULL_SCALE_MM_S 2000 // Speed that lights the whole bar
+#define RACE_DISPLAY_LEVEL 48 // Brightness out of 255, which keeps a long strip within USB power
+
+static sched_task_id race_display_task_id = -1;
+static sched_task_id race_display_blank_task_id = -1;
+
+// --- Session state
+static uint32_t race_laps = 0;
+static uint32_t race_best_lap_ms = 0;
+static bool race_last_was_best = false;
+
+static void race_display_draw_speed(unsigned int bar_leds) {
+    SpeedEstimate est = speed_est_get();
+    float speed = est.valid ? est.velocity_mm_s : 0.0f;
+    if (speed < 0) {
+        speed = -speed; // Towards or away from the sensor
+    }
+    unsigned int lit = (unsigned int)(speed * bar_leds / RACE_DISPLAY_FULL_SCALE_MM_S);
+    if (lit > bar_leds) {
+        lit = bar_leds;
+    }
+
+    // Green at the slow end of the bar, fading to red at full scale
+    for (unsigned int i = 0; i < bar_leds; i++) {
+        if (i < lit) {
+            uint8_t red = (uint8_t)(RACE_DISPLAY_LEVEL * i / bar_leds);
+            led_strip_set_pixel(i, red, RACE_DISPLAY_LEVEL - red, 0);
+        } else {
+            led_strip_set_pixel(i, 0, 0, 0);
+        }
+    }
+}
+
+static void race_display_draw_laps(unsigned int first) {
+    // One LED per lap, wrapping every RACE_DISPLAY_LAP_LEDS laps
+    unsigned int shown = race_laps == 0 ? 0 : (race_laps - 1) % RACE_DISPLAY_LAP_LEDS + 1;
+    for (unsigned int i = 0; i < RACE_DISPLAY_LAP_LEDS; i++) {
+        if (i + 1 < shown) {
+            led_strip_set_pixel(first + i, 0, 0, RACE_DISPLAY_LEVEL);
+        } else if (i + 1 == shown) {
+            led_strip_set_pixel(first + i, race_last_was_best ? 0 : RACE_DISPLAY_LEVEL,
+                                race_last_was_best ? RACE_DISPLAY_LEVEL : 0, 0);
+        } else {
+            led_strip_set_pixel(first + i, 0, 0, 0);
+        }
+    }
+}
+
+// Task: draw the frame and start sending it. A frame still on the wire means this one is skipped, and the next
+// period draws a fresher one.
+static void race_display_task() {
+    unsigned int bar_leds = led_strip_length() - RACE_DISPLAY_LAP_LEDS;
+    race_display_draw_speed(bar_leds);
+    race_display_draw_laps(bar_leds);
+    led_strip_show();
+}
+
+// Task: blank the strip, waiting for the frame being sent to latch first
+static void race_display_blank_task() {
+    led_strip_clear();
+    if (led_strip_show()) {
+        race_display_blank_task_id = -1;
+    } else {
+        race_display_blank_task_id = sched_add_oneshot(race_display_blank_task, RACE_DISPLAY_BLANK_RETRY_US);
+    }
+}
+
+void race_display_init() {
+    led_strip_init(pio0, RACE_DISPLAY_PIN, RACE_DISPLAY_LEDS);
+}
+
+void race_display_start_tasks() {
+    if (race_display_task_id >= 0) {
+        return;
+    }
+    sched_cancel(race_display_blank_task_id);
+    race_display_blank_task_id = -1;
+    race_laps = 0;
+    race_best_lap_ms = 0;
+    race_last_was_best = false;
+    race_display_task_id = sched_add_periodic(race_display_task, RACE_DISPLAY_PERIOD_US);
+}
+
+void race_display_stop_tasks() {
+    if (race_display_task_id < 0) {
+        return;
+    }
+    sched_cancel(race_display_task_id);
+    race_display_task_id = -1;
+    race_display_blank_task();
+}
+
+void race_display_lap(uint32_t lap_ms) {
+    race_laps++;
+    race_last_was_best = race_best_lap_ms == 0 || lap_ms < race_best_lap_ms;
+    if (race_last_was_best) {
+        race_best_lap_ms = lap_ms;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Set up the LED strip that shows race status. Call once from core 0.
+void race_display_init();
+
+/// Start redrawing the strip from the speed estimate and lap times, beginning a new session (no best lap).
+void race_display_start_tasks();
+
+/// Stop redrawing and blank the strip.
+void race_display_stop_tasks();
+
+/// Record a completed lap. Call from core 0.
+void race_display_lap(uint32_t lap_ms);
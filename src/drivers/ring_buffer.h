@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/// Lock-free ring buffer for exactly one producer and one consumer, e.g. an interrupt handler feeding a task.
+/// The producer only writes `head` and the consumer only writes `tail`; both indices run freely and wrap, so N must be
+/// a power of two.
+template <typename T, size_t N>
+class RingBuffer {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
+public:
+    /// Producer: append an item. Returns false (and drops the item) if the buffer is full.
+    bool push(const T &item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) {
+            return false;
+        }
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer: remove the oldest item. Returns false if the buffer is empty.
+    bool pop(T *item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            return false;
+        }
+        *item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer: copy the oldest item without removing it. Returns false if the buffer is empty.
+    bool peek(T *item) const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            return false;
+        }
+        *item = items[t & (N - 1)];
+        return true;
+    }
+
+    /// Number of items waiting. Only exact when called from the producer or the consumer.
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+private:
+    T items[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+};
@@ -0,0 +1,184 @@
+// Deadline-ordered cooperative scheduler, using the style that state is global in the C file.
+//
+// Tasks live in a fixed table and a binary min-heap orders them by deadline, so finding the next task is O(1) and
+// adding, cancelling or rescheduling one is O(log n). Between deadlines the core sleeps in WFE; any interrupt (e.g. a
+// button press) wakes it early so the main loop can react. Each core has an independent scheduler.
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+#include "pico/platform.h"
+#include "drivers/scheduler.h"
+#include "drivers/logging/logging.h"
+
+#define SCHED_MAX_TASKS 16
+
+struct SchedTask {
+    sched_task_fn fn;
+    uint32_t period_us; // 0 for one-shot tasks
+    uint64_t deadline_us;
+    int heap_index;     // Position in the heap, or -1 if the slot is free
+};
+
+// --- Scheduler internal state:
+// Each core runs its own scheduler, so the state is kept per core and task ids are only meaningful on the core that
+// created them.
+struct SchedState {
+    SchedTask tasks[SCHED_MAX_TASKS];
+    int heap[SCHED_MAX_TASKS]; // Task slots, ordered as a min-heap on deadline
+    int heap_size;
+    bool initialised;
+};
+static SchedState sched_state[NUM_CORES];
+
+// State for the calling core, initialised on first use
+static SchedState &sched_current() {
+    SchedState &state = sched_state[get_core_num()];
+    if (!state.initialised) {
+        for (int i = 0; i < SCHED_MAX_TASKS; i++) {
+            state.tasks[i].heap_index = -1;
+        }
+        state.initialised = true;
+    }
+    return state;
+}
+
+static bool sched_earlier(SchedState &s, int a, int b) {
+    return s.tasks[s.heap[a]].deadline_us < s.tasks[s.heap[b]].deadline_us;
+}
+
+static void sched_swap(SchedState &s, int a, int b) {
+    int slot = s.heap[a];
+    s.heap[a] = s.heap[b];
+    s.heap[b] = slot;
+    s.tasks[s.heap[a]].heap_index = a;
+    s.tasks[s.heap[b]].heap_index = b;
+}
+
+// Restore heap order around position i after its deadline changed
+static void sched_sift(SchedState &s, int i) {
+    while (i > 0 && sched_earlier(s, i, (i - 1) / 2)) {
+        sched_swap(s, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < s.heap_size && sched_earlier(s, left, smallest)) {
+            smallest = left;
+        }
+        if (right < s.heap_size && sched_earlier(s, right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        sched_swap(s, i, smallest);
+        i = smallest;
+    }
+}
+
+static void sched_heap_push(SchedState &s, int slot) {
+    s.heap[s.heap_size] = slot;
+    s.tasks[slot].heap_index = s.heap_size;
+    s.heap_size++;
+    sched_sift(s, s.heap_size - 1);
+}
+
+static void sched_heap_remove(SchedState &s, int slot) {
+    int i = s.tasks[slot].heap_index;
+    s.heap_size--;
+    if (i != s.heap_size) {
+        sched_swap(s, i, s.heap_size);
+        sched_sift(s, i);
+    }
+    s.tasks[slot].heap_index = -1;
+}
+
+static sched_task_id sched_add(sched_task_fn fn, uint32_t delay_us, uint32_t period_us) {
+    SchedState &s = sched_current();
+    for (int slot = 0; slot < SCHED_MAX_TASKS; slot++) {
+        if (s.tasks[slot].heap_index < 0 && s.tasks[slot].fn == nullptr) {
+            s.tasks[slot].fn = fn;
+            s.tasks[slot].period_us = period_us;
+            s.tasks[slot].deadline_us = time_us_64() + delay_us;
+            sched_heap_push(s, slot);
+            return slot;
+        }
+    }
+    LOG_ERROR(MODULE_MAIN, "Scheduler full, task not added");
+    return -1;
+}
+
+sched_task_id sched_add_periodic(sched_task_fn fn, uint32_t period_us) {
+    return sched_add(fn, period_us, period_us);
+}
+
+sched_task_id sched_add_oneshot(sched_task_fn fn, uint32_t delay_us) {
+    return sched_add(fn, delay_us, 0);
+}
+
+void sched_reschedule(sched_task_id id, uint32_t delay_us) {
+    SchedState &s = sched_current();
+    if (id < 0 || id >= SCHED_MAX_TASKS || s.tasks[id].fn == nullptr) {
+        return;
+    }
+    s.tasks[id].deadline_us = time_us_64() + delay_us;
+    // A periodic task that is currently running goes back on the heap with this deadline when it returns
+    if (s.tasks[id].heap_index >= 0) {
+        sched_sift(s, s.tasks[id].heap_index);
+    }
+}
+
+void sched_cancel(sched_task_id id) {
+    SchedState &s = sched_current();
+    if (id < 0 || id >= SCHED_MAX_TASKS) {
+        return;
+    }
+    if (s.tasks[id].heap_index >= 0) {
+        sched_heap_remove(s, id);
+    }
+    s.tasks[id].fn = nullptr;
+}
+
+void sched_run_pending() {
+    SchedState &s = sched_current();
+    uint64_t now = time_us_64();
+    while (s.heap_size > 0 && s.tasks[s.heap[0]].deadline_us <= now) {
+        int slot = s.heap[0];
+        SchedTask *task = &s.tasks[slot];
+        sched_task_fn fn = task->fn;
+
+        // Take the task off the heap while it runs, so it can cancel or reschedule itself
+        sched_heap_remove(s, slot);
+        if (task->period_us == 0) {
+            task->fn = nullptr;
+        } else {
+            // Keep periodic tasks on their original grid, but skip missed periods rather than running them in a burst
+            task->deadline_us += task->period_us;
+            if (task->deadline_us <= now) {
+                task->deadline_us = now + task->period_us;
+            }
+        }
+
+        fn();
+
+        if (task->fn == fn && task->period_us != 0 && task->heap_index < 0) {
+            sched_heap_push(s, slot);
+        }
+        now = time_us_64();
+    }
+}
+
+void sched_wait() {
+    SchedState &s = sched_current();
+    if (s.heap_size == 0) {
+        // Nothing scheduled: only an interrupt or the other core can create work
+        __wfe();
+        return;
+    }
+    best_effort_wfe_or_timeout(from_us_since_boot(s.tasks[s.heap[0]].deadline_us));
+}
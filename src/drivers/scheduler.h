@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+/// A task is a plain function run from the scheduler loop (never from an interrupt).
+typedef void (*sched_task_fn)(void);
+
+/// Handle returned when a task is added. Negative values mean the task could not be added.
+typedef int sched_task_id;
+
+/// Run `fn` every `period_us`, starting one period from now.
+sched_task_id sched_add_periodic(sched_task_fn fn, uint32_t period_us);
+
+/// Run `fn` once, `delay_us` from now.
+sched_task_id sched_add_oneshot(sched_task_fn fn, uint32_t delay_us);
+
+/// Move a task's next deadline to `delay_us` from now. Periodic tasks continue with their period from there.
+void sched_reschedule(sched_task_id id, uint32_t delay_us);
+
+/// Remove a task. Safe to call from within the task itself, and with an id that has already finished.
+void sched_cancel(sched_task_id id);
+
+/// Run every task whose deadline has passed. Each core has its own task list; call this from the core that added them.
+void sched_run_pending();
+
+/// Sleep until the next deadline, or until an interrupt wakes the core.
+void sched_wait();
@@ -0,0 +1,88 @@
+#include <math.h>
+#include "drivers/speed_estimator.h"
+
+// Alpha-beta-gamma tracker gains (position, velocity, acceleration). Lower values smooth more but lag more.
+#define EST_ALPHA 0.5f
+#define EST_BETA 0.15f
+#define EST_GAMMA 0.01f
+
+// A sample further than this from the prediction is treated as a glitch
+#define EST_GATE_MM 150.0f
+// This many glitches in a row means the object really jumped (e.g. a different car in the beam), so start over
+#define EST_MAX_REJECTS 3
+// Samples further apart than this do not describe the same motion, so start over
+#define EST_MAX_GAP_US 1000000
+
+static SpeedEstimate est_state = {0.0f, 0.0f, 0.0f, false};
+static bool est_started = false;
+static uint64_t est_last_us = 0;
+static uint32_t est_rejects_in_row = 0;
+static uint32_t est_rejected = 0;
+
+// Start a new track at the given sample
+static void speed_est_start(float z, uint64_t time_us) {
+    est_state.position_mm = z;
+    est_state.velocity_mm_s = 0.0f;
+    est_state.accel_mm_s2 = 0.0f;
+    est_state.valid = false;
+    est_started = true;
+    est_last_us = time_us;
+    est_rejects_in_row = 0;
+}
+
+void speed_est_reset() {
+    est_state.valid = false;
+    est_started = false;
+    est_rejects_in_row = 0;
+}
+
+bool speed_est_update(uint16_t distance_mm, uint64_t time_us) {
+    float z = (float)distance_mm;
+    if (!est_started || time_us <= est_last_us || time_us - est_last_us > EST_MAX_GAP_US) {
+        speed_est_start(z, time_us);
+        return true;
+    }
+
+    float dt = (time_us - est_last_us) / 1e6f;
+    float x = est_state.position_mm;
+    float v = est_state.velocity_mm_s;
+    float a = est_state.accel_mm_s2;
+
+    // The second sample seeds the velocity; there is nothing to predict from yet
+    if (!est_state.valid) {
+        est_state.velocity_mm_s = (z - x) / dt;
+        est_state.position_mm = z;
+        est_state.valid = true;
+        est_last_us = time_us;
+        return true;
+    }
+
+    // Predict to the sample time
+    float x_pred = x + v * dt + 0.5f * a * dt * dt;
+    float v_pred = v + a * dt;
+    float r = z - x_pred;
+
+    if (fabsf(r) > EST_GATE_MM) {
+        est_rejected++;
+        if (++est_rejects_in_row >= EST_MAX_REJECTS) {
+            speed_est_start(z, time_us);
+        }
+        return false;
+    }
+    est_rejects_in_row = 0;
+
+    // Correct with the innovation
+    est_state.position_mm = x_pred + EST_ALPHA * r;
+    est_state.velocity_mm_s = v_pred + EST_BETA * r / dt;
+    est_state.accel_mm_s2 = a + 2.0f * EST_GAMMA * r / (dt * dt);
+    est_last_us = time_us;
+    return true;
+}
+
+SpeedEstimate speed_est_get() {
+    return est_state;
+}
+
+uint32_t speed_est_rejected_count() {
+    return est_rejected;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Smoothed state of the tracked object. Distances are along the sensor axis, positive away from the sensor.
+struct SpeedEstimate {
+    float position_mm;
+    float velocity_mm_s;
+    float accel_mm_s2;
+    bool valid; ///< False until the estimator has seen two samples.
+};
+
+/// Forget the current track. The next sample starts a new one.
+void speed_est_reset();
+
+/// Fuse one distance sample taken at `time_us`. Samples that disagree with the prediction by more than the
+/// innovation gate are ignored; after several in a row the estimator assumes a new object and restarts.
+/// Returns false if the sample was rejected.
+bool speed_est_update(uint16_t distance_mm, uint64_t time_us);
+
+/// Current estimate.
+SpeedEstimate speed_est_get();
+
+/// Number of samples rejected by the innovation gate since boot.
+uint32_t speed_est_rejected_count();
@@ -0,0 +1,118 @@
+// Binary telemetry framing, using the style that state is global in the C file.
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/time.h"
+#include "drivers/uart_tx.h"
+#include "drivers/telemetry/telemetry.h"
+
+#define TELEMETRY_HEADER 6 // type, sequence, timestamp
+#define TELEMETRY_CRC 2
+#define TELEMETRY_MAX_FRAME (TELEMETRY_HEADER + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC)
+// COBS adds one byte per 254 plus one; the frame is also wrapped in two delimiters
+#define TELEMETRY_MAX_ENCODED (TELEMETRY_MAX_FRAME + TELEMETRY_MAX_FRAME / 254 + 1 + 2)
+
+static uint8_t telemetry_sequence = 0;
+static uint32_t telemetry_sent = 0;
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF), computed bitwise to avoid a table
+static uint16_t telemetry_crc16(const uint8_t *data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Consistent Overhead Byte Stuffing: removes every 0x00 from the frame so 0x00 can delimit frames.
+// Returns the encoded length, at most length + length / 254 + 1.
+static size_t telemetry_cobs_encode(const uint8_t *in, size_t length, uint8_t *out) {
+    size_t code_index = 0;
+    size_t out_index = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] != 0) {
+            out[out_index++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_index] = code;
+            code = 1;
+            code_index = out_index++;
+        }
+    }
+    out[code_index] = code;
+    return out_index;
+}
+
+static void telemetry_put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void telemetry_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+bool telemetry_send(TelemetryType type, const void *payload, size_t length) {
+    if (length > TELEMETRY_MAX_PAYLOAD) {
+        return false;
+    }
+
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    frame[0] = type;
+    frame[1] = telemetry_sequence++;
+    telemetry_put_u32(frame + 2, to_ms_since_boot(get_absolute_time()));
+    memcpy(frame + TELEMETRY_HEADER, payload, length);
+    size_t frame_length = TELEMETRY_HEADER + length;
+    telemetry_put_u16(frame + frame_length, telemetry_crc16(frame, frame_length));
+    frame_length += TELEMETRY_CRC;
+
+    // The leading delimiter ends any console text, so it can't run into this frame
+    uint8_t encoded[TELEMETRY_MAX_ENCODED];
+    encoded[0] = 0x00;
+    size_t encoded_length = 1 + telemetry_cobs_encode(frame, frame_length, encoded + 1);
+    encoded[encoded_length++] = 0x00;
+
+    // Queued whole, so a frame never interleaves with console text
+    if (!uart_tx_write(encoded, encoded_length)) {
+        return false;
+    }
+    telemetry_sent++;
+    return true;
+}
+
+void telemetry_send_weight(int32_t weight_g, bool stable) {
+    uint8_t payload[5];
+    telemetry_put_u32(payload, (uint32_t)weight_g);
+    payload[4] = stable ? 1 : 0;
+    telemetry_send(TELEM_WEIGHT, payload, sizeof(payload));
+}
+
+void telemetry_send_lap(uint32_t lap_ms) {
+    uint8_t payload[4];
+    telemetry_put_u32(payload, lap_ms);
+    telemetry_send(TELEM_LAP, payload, sizeof(payload));
+}
+
+void telemetry_send_speed(int32_t speed_mm_s) {
+    uint8_t payload[4];
+    telemetry_put_u32(payload, (uint32_t)speed_mm_s);
+    telemetry_send(TELEM_SPEED, payload, sizeof(payload));
+}
+
+void telemetry_send_distance(uint16_t distance_mm) {
+    uint8_t payload[2];
+    telemetry_put_u16(payload, distance_mm);
+    telemetry_send(TELEM_DISTANCE, payload, sizeof(payload));
+}
+
+uint32_t telemetry_records_sent() {
+    return telemetry_sent;
+}
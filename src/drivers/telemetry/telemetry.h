@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary telemetry to the Raspberry Pi.
+//
+// Each record is framed as
+//     type (1 byte), sequence (1 byte), timestamp in ms since boot (4 bytes), payload, CRC-16 (2 bytes)
+// then COBS encoded and delimited by 0x00 on both sides, so the receiver can resynchronise after noise or console
+// text. Multi-byte fields are little-endian; the CRC is CRC-16/CCITT-FALSE over everything before it.
+// tools/telemetry.py parses the stream on the Pi.
+
+/// Record types and their payloads.
+enum TelemetryType : uint8_t {
+    TELEM_WEIGHT = 1,   ///< int32 grams, uint8 flags (bit 0: the load has settled)
+    TELEM_LAP = 2,      ///< uint32 lap time in ms
+    TELEM_SPEED = 3,    ///< int32 speed in mm/s, positive away from the sensor
+    TELEM_DISTANCE = 4, ///< uint16 distance in mm
+    TELEM_BATCH = 5,    ///< One aggregation window of samples; see telemetry_batch.h
+};
+
+/// Largest payload a record can carry.
+#define TELEMETRY_MAX_PAYLOAD 192
+
+/// Frame and send one record. Call from one core only. Returns false if the payload is too long.
+bool telemetry_send(TelemetryType type, const void *payload, size_t length);
+
+void telemetry_send_weight(int32_t weight_g, bool stable);
+
+void telemetry_send_lap(uint32_t lap_ms);
+
+void telemetry_send_speed(int32_t speed_mm_s);
+
+void telemetry_send_distance(uint16_t distance_mm);
+
+/// Number of records sent since boot.
+uint32_t telemetry_records_sent();
@@ -0,0 +1,197 @@
+// Telemetry aggregation windows, using the style that state is global in the C file.
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+#include "drivers/scheduler.h"
+#include "drivers/telemetry/telemetry.h"
+#include "drivers/telemetry/telemetry_batch.h"
+
+#define BATCH_HEADER_SIZE 2         // window length
+#define BATCH_SECTION_HEADER_SIZE 4 // channel, mode, count
+#define BATCH_SUMMARY_SIZE 12       // min, max, mean
+#define BATCH_RAW_SAMPLE_SIZE 6     // time offset, value
+#define BATCH_MAX_RAW ((TELEMETRY_MAX_PAYLOAD - BATCH_HEADER_SIZE - BATCH_SECTION_HEADER_SIZE) / BATCH_RAW_SAMPLE_SIZE)
+#define BATCH_MAX_WINDOW_MS 65535
+
+// Defaults: the fast signals as summaries, and the rare or motion-critical ones in full
+#define BATCH_DEFAULT_WEIGHT BATCH_SUMMARY
+#define BATCH_DEFAULT_DISTANCE BATCH_RAW
+#define BATCH_DEFAULT_SPEED BATCH_SUMMARY
+#define BATCH_DEFAULT_LAP BATCH_RAW
+
+struct BatchRawSample {
+    uint16_t offset_ms;
+    int32_t value;
+};
+
+struct BatchChannel {
+    TelemetryBatchMode mode;
+    uint16_t count;
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+    BatchRawSample raw[BATCH_MAX_RAW];
+};
+
+static BatchChannel batch_channels[CHANNEL_COUNT] = {
+    {BATCH_DEFAULT_WEIGHT}, {BATCH_DEFAULT_DISTANCE}, {BATCH_DEFAULT_SPEED}, {BATCH_DEFAULT_LAP},
+};
+static uint64_t batch_window_start_us = 0;
+static uint32_t batch_window_ms = 1000;
+static sched_task_id batch_task_id = -1;
+
+static void batch_put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void batch_put_i32(uint8_t *p, int32_t v) {
+    batch_put_u16(p, (uint16_t)v);
+    batch_put_u16(p + 2, (uint16_t)((uint32_t)v >> 16));
+}
+
+// Bytes a channel takes in the record
+static size_t batch_section_size(const BatchChannel *ch) {
+    if (ch->mode == BATCH_OFF || ch->count == 0) {
+        return 0;
+    }
+    return BATCH_SECTION_HEADER_SIZE + (ch->mode == BATCH_SUMMARY ? BATCH_SUMMARY_SIZE : ch->count * BATCH_RAW_SAMPLE_SIZE);
+}
+
+static size_t batch_payload_size() {
+    size_t size = BATCH_HEADER_SIZE;
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        size += batch_section_size(&batch_channels[i]);
+    }
+    return size;
+}
+
+void telemetry_batch_flush() {
+    uint64_t now_us = time_us_64();
+    uint64_t window_ms = (now_us - batch_window_start_us) / 1000;
+    batch_window_start_us = now_us;
+
+    static uint8_t payload[TELEMETRY_MAX_PAYLOAD]; // Static to keep it off the scheduler's stack
+    size_t length = BATCH_HEADER_SIZE;
+    batch_put_u16(payload, window_ms < BATCH_MAX_WINDOW_MS ? (uint16_t)window_ms : BATCH_MAX_WINDOW_MS);
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        BatchChannel *ch = &batch_channels[i];
+        if (batch_section_size(ch) == 0) {
+            ch->count = 0;
+            continue;
+        }
+        payload[length] = (uint8_t)i;
+        payload[length + 1] = ch->mode;
+        batch_put_u16(payload + length + 2, ch->count);
+        length += BATCH_SECTION_HEADER_SIZE;
+        if (ch->mode == BATCH_SUMMARY) {
+            batch_put_i32(payload + length, ch->min);
+            batch_put_i32(payload + length + 4, ch->max);
+            batch_put_i32(payload + length + 8, (int32_t)(ch->sum / ch->count));
+            length += BATCH_SUMMARY_SIZE;
+        } else {
+            for (uint16_t j = 0; j < ch->count; j++) {
+                batch_put_u16(payload + length, ch->raw[j].offset_ms);
+                batch_put_i32(payload + length + 2, ch->raw[j].value);
+                length += BATCH_RAW_SAMPLE_SIZE;
+            }
+        }
+        ch->count = 0;
+    }
+
+    if (length > BATCH_HEADER_SIZE) {
+        telemetry_send(TELEM_BATCH, payload, length);
+    }
+}
+
+void telemetry_batch_add(TelemetryChannel channel, int32_t value) {
+    BatchChannel *ch = &batch_channels[channel];
+    if (ch->mode == BATCH_OFF) {
+        return;
+    }
+
+    // Send the window early rather than lose samples when the record is full
+    size_t extra = ch->mode == BATCH_SUMMARY ? (ch->count == 0 ? BATCH_SECTION_HEADER_SIZE + BATCH_SUMMARY_SIZE : 0)
+                                             : (ch->count == 0 ? BATCH_SECTION_HEADER_SIZE : 0) + BATCH_RAW_SAMPLE_SIZE;
+    if (batch_payload_size() + extra > TELEMETRY_MAX_PAYLOAD) {
+        telemetry_batch_flush();
+        if (batch_task_id >= 0) {
+            sched_reschedule(batch_task_id, batch_window_ms * 1000);
+        }
+    }
+
+    if (ch->mode == BATCH_SUMMARY) {
+        if (ch->count == 0) {
+            ch->min = value;
+            ch->max = value;
+            ch->sum = 0;
+        }
+        if (value < ch->min) {
+            ch->min = value;
+        }
+        if (value > ch->max) {
+            ch->max = value;
+        }
+        ch->sum += value;
+        if (ch->count < UINT16_MAX) {
+            ch->count++;
+        }
+    } else {
+        uint64_t offset_ms = (time_us_64() - batch_window_start_us) / 1000;
+        ch->raw[ch->count].offset_ms = offset_ms < BATCH_MAX_WINDOW_MS ? (uint16_t)offset_ms : BATCH_MAX_WINDOW_MS;
+        ch->raw[ch->count].value = value;
+        ch->count++;
+    }
+}
+
+void telemetry_batch_set_mode(TelemetryChannel channel, TelemetryBatchMode mode) {
+    // The layouts differ, so the samples collected so far go out in the old mode first
+    if (batch_channels[channel].mode != mode) {
+        telemetry_batch_flush();
+        batch_channels[channel].mode = mode;
+    }
+}
+
+TelemetryBatchMode telemetry_batch_get_mode(TelemetryChannel channel) {
+    return batch_channels[channel].mode;
+}
+
+// Scheduler task: one record per window
+static void telemetry_batch_task() {
+    telemetry_batch_flush();
+}
+
+static uint32_t batch_clamp_window(uint32_t window_ms) {
+    if (window_ms == 0) {
+        return 1;
+    }
+    return window_ms < BATCH_MAX_WINDOW_MS ? window_ms : BATCH_MAX_WINDOW_MS;
+}
+
+void telemetry_batch_set_window(uint32_t window_ms) {
+    telemetry_batch_flush();
+    batch_window_ms = batch_clamp_window(window_ms);
+    if (batch_task_id >= 0) {
+        sched_cancel(batch_task_id);
+        batch_task_id = sched_add_periodic(telemetry_batch_task, batch_window_ms * 1000);
+    }
+}
+
+void telemetry_batch_start(uint32_t window_ms) {
+    if (batch_task_id >= 0) {
+        return;
+    }
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        batch_channels[i].count = 0;
+    }
+    batch_window_start_us = time_us_64();
+    batch_window_ms = batch_clamp_window(window_ms);
+    batch_task_id = sched_add_periodic(telemetry_batch_task, batch_window_ms * 1000);
+}
+
+void telemetry_batch_stop() {
+    telemetry_batch_flush();
+    sched_cancel(batch_task_id);
+    batch_task_id = -1;
+}
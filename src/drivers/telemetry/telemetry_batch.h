@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+// Batched telemetry: samples are collected per channel and sent as one TELEM_BATCH record per window, which saves the
+// per-record overhead and UART wakeups of sending each sample on its own.
+//
+// TELEM_BATCH payload:
+//     uint16 window length in ms, then one section per channel that has samples:
+//     uint8 channel, uint8 mode, uint16 sample count, then
+//         summary: int32 min, int32 max, int32 mean
+//         raw:     count x (uint16 ms since the window started, int32 value)
+// The record's timestamp is the end of the window.
+
+/// Sample sources. Values are in the units of the matching single-sample record.
+enum TelemetryChannel : uint8_t {
+    CHANNEL_WEIGHT = 0,   ///< grams
+    CHANNEL_DISTANCE = 1, ///< mm
+    CHANNEL_SPEED = 2,    ///< mm/s
+    CHANNEL_LAP = 3,      ///< lap time in ms
+    CHANNEL_COUNT
+};
+
+/// How a channel's samples are reported.
+enum TelemetryBatchMode : uint8_t {
+    BATCH_OFF = 0,     ///< Samples are discarded.
+    BATCH_SUMMARY = 1, ///< Min, max, mean and count for the window.
+    BATCH_RAW = 2,     ///< Every sample with its time. A window that fills the record is sent early.
+};
+
+/// Start sending a batch every `window_ms` (at most 65535) from the calling core's scheduler.
+void telemetry_batch_start(uint32_t window_ms);
+
+void telemetry_batch_stop();
+
+/// Change the window length. The current window is sent first.
+void telemetry_batch_set_window(uint32_t window_ms);
+
+void telemetry_batch_set_mode(TelemetryChannel channel, TelemetryBatchMode mode);
+
+TelemetryBatchMode telemetry_batch_get_mode(TelemetryChannel channel);
+
+/// Add a sample to the current window. Call from the core that started batching.
+void telemetry_batch_add(TelemetryChannel channel, int32_t value);
+
+/// Send the current window now, if it has any samples, and start a new one.
+void telemetry_batch_flush();
@@ -0,0 +1,97 @@
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "TM1637.pio.h"
+#include "drivers/tm1637.h"
+
+// TM1637 commands
+#define TM1637_CMD_DATA 0x40    // Write data, auto-increment address
+#define TM1637_CMD_DATA_FIXED 0x44 // Write data to a single address
+#define TM1637_CMD_ADDRESS 0xC0 // Address of digit 0; add the digit number
+#define TM1637_CMD_CONTROL 0x80 // Display control; 0x08 = on, low 3 bits = brightness
+
+// All displays run on pio1, which keeps pio0 free for the HX711 and the LEDs
+static PIO tm1637_pio = pio1;
+
+TM1637 tm1637_main_display(18, 19);
+TM1637 tm1637_lap_display(11, 12);
+
+int TM1637::program_offset = -1;
+
+void TM1637::init() {
+    if (sm >= 0) {
+        return;
+    }
+    // Load the program once, the first time any display is initialised
+    if (program_offset < 0) {
+        program_offset = pio_add_program(tm1637_pio, &tm1637_program);
+    }
+    sm = pio_claim_unused_sm(tm1637_pio, true);
+    tm1637_program_init(tm1637_pio, sm, program_offset, dio_pin, clk_pin);
+    set_brightness(7);
+}
+
+// Queue one byte. A whole frame fits in the joined TX FIFO, so this only blocks if frames are sent back to back.
+void TM1637::put(uint8_t data, bool start, bool stop) {
+    pio_sm_put_blocking(tm1637_pio, sm, tm1637_word(data, start, stop));
+    traffic.bytes_sent++;
+}
+
+// The data command is remembered by the display, so it only needs sending when the addressing mode changes
+void TM1637::set_data_mode(uint8_t mode) {
+    if (mode != data_mode) {
+        put(mode, true, true);
+        data_mode = mode;
+    }
+}
+
+void TM1637::set_brightness(uint8_t brightness) {
+    uint8_t control = TM1637_CMD_CONTROL | 0x08 | (brightness & 0x07);
+    if (control != display_control) {
+        put(control, true, true);
+        display_control = control;
+    }
+}
+
+void TM1637::show_segments(const uint8_t segments[4]) {
+    // Find the span of digits that differ from what is on the display
+    int first = 0;
+    int last = 3;
+    if (frame_valid) {
+        while (first < 4 && segments[first] == frame[first]) {
+            first++;
+        }
+        if (first == 4) {
+            traffic.frames_skipped++;
+            return;
+        }
+        while (segments[last] == frame[last]) {
+            last--;
+        }
+    }
+
+    if (first == last) {
+        // A single digit: write it to its own address
+        set_data_mode(TM1637_CMD_DATA_FIXED);
+    } else {
+        set_data_mode(TM1637_CMD_DATA);
+    }
+    put(TM1637_CMD_ADDRESS + first, true, false);
+    for (int i = first; i <= last; i++) {
+        put(segments[i], false, i == last);
+        frame[i] = segments[i];
+    }
+    frame_valid = true;
+    traffic.frames_sent++;
+}
+void TM1637::show_digits(int d0, int d1, int d2, int d3, bool colon) {
+    uint8_t segments[4] = {
+        tm1637_digit_segments[d0],
+        tm1637_digit_segments[d1],
+        tm1637_digit_segments[d2],
+        tm1637_digit_segments[d3],
+    };
+    if (colon) {
+        segments[1] |= TM1637_SEG_COLON;
+    }
+    show_segments(segments);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include "hardware/pio.h"
+
+/// Segment patterns for the digits 0-9.
+inline constexpr uint8_t tm1637_digit_segments[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+#define TM1637_SEG_MINUS 0x40
+/// Set on the second digit to light the colon.
+#define TM1637_SEG_COLON 0x80
+
+/// Bus traffic counters for one display.
+struct TM1637Stats {
+    uint32_t frames_sent;    ///< Frames that changed at least one digit.
+    uint32_t frames_skipped; ///< Frames identical to what the display already shows.
+    uint32_t bytes_sent;     ///< Bytes clocked out, commands included.
+};
+
+/// TM1637 4-digit 7-segment display. Frames are sent by a PIO state machine, so an update only costs a few FIFO
+/// writes; every display shares one copy of the program on pio1. The last frame sent is cached, and only the digits
+/// that changed are rewritten.
+class TM1637 {
+public:
+    constexpr TM1637(uint8_t dio_pin, uint8_t clk_pin) : dio_pin(dio_pin), clk_pin(clk_pin) {}
+
+    /// Claim a state machine and switch the display on at full brightness. Later calls do nothing.
+    void init();
+
+    /// Set the brightness, 0 (dimmest) to 7, and switch the display on.
+    void set_brightness(uint8_t brightness);
+
+    /// Show raw segment patterns, leftmost digit first.
+    void show_segments(const uint8_t segments[4]);
+
+    /// Show four decimal digits, optionally with the colon.
+    void show_digits(int d0, int d1, int d2, int d3, bool colon);
+
+    /// Frames sent and skipped since init.
+    TM1637Stats stats() const { return traffic; }
+
+private:
+    void put(uint8_t data, bool start, bool stop);
+    void set_data_mode(uint8_t mode);
+
+    uint8_t dio_pin;
+    uint8_t clk_pin;
+    int sm = -1;
+
+    // What the display currently shows, so unchanged frames cost nothing
+    uint8_t frame[4] = {0, 0, 0, 0};
+    bool frame_valid = false;
+    uint8_t display_control = 0; // Last control command sent
+    uint8_t data_mode = 0;       // Last data command sent (auto-increment or fixed address)
+    TM1637Stats traffic = {0, 0, 0};
+
+    static int program_offset;
+};
+
+/// Display shared by the load cell and the running lap timer (DIO 18, CLK 19).
+extern TM1637 tm1637_main_display;
+
+/// Display showing the last lap time (DIO 11, CLK 12).
+extern TM1637 tm1637_lap_display;
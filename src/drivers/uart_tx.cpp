@@ -0,0 +1,186 @@
+// DMA-driven UART transmit queue, using the style that state is global in the C file.
+//
+// Records are copied into a byte ring; a DMA channel paced by the UART's TX DREQ sends everything queued in one
+// transfer, and its completion interrupt starts the next transfer with whatever was queued meanwhile. The ring is
+// aligned to its size so the DMA's address wrapping handles records that straddle the end of the ring.
+//
+// Positions are free-running byte counts: [tx_tail, tx_send) is being sent by the DMA and [tx_send, tx_head) is
+// queued. Only queued records can be dropped, so their end positions are kept in a separate small ring.
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/stdio.h"
+#include "pico/stdio_uart.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/uart.h"
+#include "drivers/uart_tx.h"
+
+#define UART_TX_RING_BITS 11
+#define UART_TX_RING_SIZE (1u << UART_TX_RING_BITS)
+#define UART_TX_RING_MASK (UART_TX_RING_SIZE - 1)
+#define UART_TX_MAX_RECORDS 64 // Power of two
+#define UART_TX_BLOCK_POLL_US 50
+
+static uint8_t tx_ring[UART_TX_RING_SIZE] __attribute__((aligned(UART_TX_RING_SIZE)));
+static uint32_t tx_head = 0;
+static uint32_t tx_send = 0;
+static volatile uint32_t tx_tail = 0;
+
+// End positions of the queued records
+static uint32_t tx_record_end[UART_TX_MAX_RECORDS];
+static uint32_t tx_record_head = 0;
+static uint32_t tx_record_tail = 0;
+
+static uart_inst_t *tx_uart = nullptr;
+static int tx_dma_channel = -1;
+static volatile bool tx_dma_busy = false;
+static UartTxPolicy tx_policy = UART_TX_BLOCK;
+static UartTxStats tx_stats = {0, 0, 0, 0, 0};
+
+static stdio_driver_t uart_tx_stdio;
+
+// Hand everything queued to the DMA. Called with interrupts disabled, or from the DMA interrupt.
+static void uart_tx_start_dma() {
+    uint32_t count = tx_head - tx_send;
+    if (count == 0) {
+        tx_dma_busy = false;
+        return;
+    }
+    tx_dma_busy = true;
+    dma_channel_set_read_addr(tx_dma_channel, &tx_ring[tx_send & UART_TX_RING_MASK], false);
+    dma_channel_set_trans_count(tx_dma_channel, count, true);
+    tx_send = tx_head;
+    tx_record_tail = tx_record_head; // Records in flight can no longer be dropped
+}
+
+static void uart_tx_dma_irq_handler() {
+    if (!dma_channel_get_irq0_status(tx_dma_channel)) {
+        return;
+    }
+    dma_channel_acknowledge_irq0(tx_dma_channel);
+    tx_tail = tx_send;
+    uart_tx_start_dma();
+}
+
+static bool uart_tx_fits(size_t length) {
+    return UART_TX_RING_SIZE - (tx_head - tx_tail) >= length && tx_record_head - tx_record_tail < UART_TX_MAX_RECORDS;
+}
+
+// Discard the oldest queued record. Returns false if nothing is queued.
+static bool uart_tx_drop_oldest() {
+    if (tx_record_tail == tx_record_head) {
+        return false;
+    }
+    uint32_t dropped = tx_record_end[tx_record_tail++ & (UART_TX_MAX_RECORDS - 1)] - tx_send;
+    tx_stats.records_dropped++;
+    tx_stats.bytes_dropped += dropped;
+
+    // Close the gap, so the space is free straight away rather than once the DMA has caught up
+    for (uint32_t pos = tx_send + dropped; pos != tx_head; pos++) {
+        tx_ring[(pos - dropped) & UART_TX_RING_MASK] = tx_ring[pos & UART_TX_RING_MASK];
+    }
+    tx_head -= dropped;
+    for (uint32_t i = tx_record_tail; i != tx_record_head; i++) {
+        tx_record_end[i & (UART_TX_MAX_RECORDS - 1)] -= dropped;
+    }
+    return true;
+}
+
+bool uart_tx_write(const uint8_t *data, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+    if (length > UART_TX_RING_SIZE) {
+        tx_stats.records_dropped++;
+        tx_stats.bytes_dropped += length;
+        return false;
+    }
+
+    uint32_t irq_status = save_and_disable_interrupts();
+    while (!uart_tx_fits(length)) {
+        if (tx_policy == UART_TX_BLOCK) {
+            // Let the DMA interrupt free some space
+            restore_interrupts(irq_status);
+            sleep_us(UART_TX_BLOCK_POLL_US);
+            irq_status = save_and_disable_interrupts();
+        } else if (tx_policy != UART_TX_DROP_OLDEST || !uart_tx_drop_oldest()) {
+            tx_stats.records_dropped++;
+            tx_stats.bytes_dropped += length;
+            restore_interrupts(irq_status);
+            return false;
+        }
+    }
+
+    // Copy in, wrapping at the end of the ring
+    uint32_t start = tx_head & UART_TX_RING_MASK;
+    size_t first = length < UART_TX_RING_SIZE - start ? length : UART_TX_RING_SIZE - start;
+    memcpy(&tx_ring[start], data, first);
+    memcpy(&tx_ring[0], data + first, length - first);
+    tx_head += length;
+    tx_record_end[tx_record_head++ & (UART_TX_MAX_RECORDS - 1)] = tx_head;
+
+    tx_stats.records_queued++;
+    tx_stats.bytes_queued += length;
+    if (tx_head - tx_tail > tx_stats.high_water) {
+        tx_stats.high_water = tx_head - tx_tail;
+    }
+
+    if (!tx_dma_busy) {
+        uart_tx_start_dma();
+    }
+    restore_interrupts(irq_status);
+    return true;
+}
+
+// stdio output: each chunk printf produces is queued as a record
+static void uart_tx_stdio_out_chars(const char *buf, int length) {
+    uart_tx_write((const uint8_t *)buf, length);
+}
+
+// stdio input still comes straight from the UART
+static int uart_tx_stdio_in_chars(char *buf, int length) {
+    int n = 0;
+    while (n < length && uart_is_readable(tx_uart)) {
+        buf[n++] = uart_getc(tx_uart);
+    }
+    return n ? n : PICO_ERROR_NO_DATA;
+}
+
+void uart_tx_init(uart_inst_t *uart, UartTxPolicy policy) {
+    tx_uart = uart;
+    tx_policy = policy;
+
+    tx_dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(tx_dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_ring(&c, false, UART_TX_RING_BITS);
+    channel_config_set_dreq(&c, uart_get_dreq(uart, true));
+    dma_channel_configure(tx_dma_channel, &c, &uart_get_hw(uart)->dr, tx_ring, 0, false);
+
+    dma_channel_set_irq0_enabled(tx_dma_channel, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, uart_tx_dma_irq_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    // Replace the blocking stdio UART driver, so printf output is queued behind (not interleaved with) records
+    uart_tx_stdio.out_chars = uart_tx_stdio_out_chars;
+    uart_tx_stdio.in_chars = uart_tx_stdio_in_chars;
+    uart_tx_stdio.crlf_enabled = true;
+    stdio_set_driver_enabled(&stdio_uart, false);
+    stdio_set_driver_enabled(&uart_tx_stdio, true);
+}
+
+void uart_tx_set_policy(UartTxPolicy policy) {
+    tx_policy = policy;
+}
+
+size_t uart_tx_pending() {
+    return tx_head - tx_tail;
+}
+
+UartTxStats uart_tx_stats() {
+    return tx_stats;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/uart.h"
+
+/// What uart_tx_write() does when the queue has no room for a record.
+enum UartTxPolicy {
+    UART_TX_DROP_NEWEST, ///< Discard the record being written.
+    UART_TX_DROP_OLDEST, ///< Discard queued records, oldest first, until it fits. Bytes already handed to the DMA are kept.
+    UART_TX_BLOCK,       ///< Wait for the DMA to make room. Never use from an interrupt handler.
+};
+
+/// Queue statistics since uart_tx_init().
+struct UartTxStats {
+    uint32_t records_queued;
+    uint32_t bytes_queued;
+    uint32_t records_dropped;
+    uint32_t bytes_dropped;
+    uint32_t high_water; ///< Most bytes ever waiting in the queue.
+};
+
+/// Take over transmission on `uart`, which must already be initialised. Claims a DMA channel and DMA_IRQ_0, and routes
+/// stdio (printf) through the queue so nothing else writes to the UART directly.
+void uart_tx_init(uart_inst_t *uart, UartTxPolicy policy);
+
+void uart_tx_set_policy(UartTxPolicy policy);
+
+/// Queue a record for transmission and return without waiting for the UART. A record is sent whole or not at all.
+/// Call from core 0. Returns false if the record was dropped.
+bool uart_tx_write(const uint8_t *data, size_t length);
+
+/// Bytes queued or being sent.
+size_t uart_tx_pending();
+
+UartTxStats uart_tx_stats();
@@ -7,6 +7,12 @@
 #include "pico/binary_info.h"
 #include "hardware/adc.h"
 #include <math.h>
+#include "hardware/timer.h"
+#include "drivers/scheduler.h"
+#include "drivers/logging/logging.h"
+#include "drivers/ultrasonic.h"
+#include "drivers/speed_estimator.h"
+#include "drivers/telemetry/telemetry_batch.h"
 
 // Ultrasonic sensor I2C configuration
 #define I2C_PORT i2c0
@@ -14,79 +20,114 @@
 #define SDA_PIN 16
 #define SCL_PIN 17
 
-// Function to read distance from the ultrasonic sensor
-uint16_t read_distance_mm() {
+// Start a new measurement as soon as the previous one can have finished; the speed estimator smooths the noise
+#define ULTRA_PERIOD_US 110000
+// The sensor needs this long after power-up before its readings can be trusted
+#define ULTRA_SETTLE_US 500000
+static sched_task_id ultra_task_id = -1;
+static sched_task_id ultra_collect_task_id = -1;
+
+// The sensor needs this long after the register write before the distance can be read
+#define ULTRA_MEASURE_TIME_US 100000
+// If the sensor NACKs the read because it isn't finished, try again this much later, up to ULTRA_MAX_RETRIES times
+#define ULTRA_RETRY_US 5000
+#define ULTRA_MAX_RETRIES 10
+
+// --- Asynchronous measurement state
+static bool ultra_busy = false;
+static uint64_t ultra_ready_us = 0;
+static uint64_t ultra_trigger_us = 0; // When the distance being measured was sampled
+static int ultra_retries = 0;
+static uint64_t ultra_settled_us = 0; // Set by ultra_init()
+
+// Start a measurement. Only the one-byte register write happens here; the result is collected by ultra_poll().
+// Returns false if the sensor did not acknowledge the write.
+bool ultra_start_measurement() {
     uint8_t reg = 0x05;
-    uint8_t buf[2] = {0};
+    if (i2c_write_blocking(I2C_PORT, I2C_ADDR, &reg, 1, true) != 1) {
+        ultra_busy = false;
+        return false;
+    }
+    ultra_busy = true;
+    ultra_trigger_us = time_us_64();
+    ultra_ready_us = ultra_trigger_us + ULTRA_MEASURE_TIME_US;
+    ultra_retries = 0;
+    return true;
+}
+
+// Check on the measurement started by ultra_start_measurement(). Never waits for the sensor: returns ULTRA_BUSY
+// until the measurement time has passed, then reads the result.
+UltraStatus ultra_poll(uint16_t *distance_mm) {
+    if (!ultra_busy) {
+        return ULTRA_IDLE;
+    }
+    uint64_t now = time_us_64();
+    if (now < ultra_ready_us) {
+        return ULTRA_BUSY;
+    }
 
-    i2c_write_blocking(I2C_PORT, I2C_ADDR, &reg, 1, true); 
-    sleep_ms(100);
-    i2c_read_blocking(I2C_PORT, I2C_ADDR, buf, 2, false);
+    uint8_t buf[2] = {0};
+    if (i2c_read_blocking(I2C_PORT, I2C_ADDR, buf, 2, false) != 2) {
+        // Not finished yet (or a bus glitch): back off briefly before giving up
+        if (++ultra_retries > ULTRA_MAX_RETRIES) {
+            ultra_busy = false;
+            return ULTRA_ERROR;
+        }
+        ultra_ready_us = now + ULTRA_RETRY_US;
+        return ULTRA_BUSY;
+    }
+    ultra_busy = false;
+    *distance_mm = (buf[0] << 8) | buf[1];
+    return ULTRA_READY;
+}
 
-    return (buf[0] << 8) | buf[1]; 
+// Function to read distance from the ultrasonic sensor
+// Blocking convenience wrapper around ultra_start_measurement() and ultra_poll().
+uint16_t read_distance_mm() {
+    uint16_t distance = 0;
+    if (!ultra_start_measurement()) {
+        return 0;
+    }
+    UltraStatus status;
+    while ((status = ultra_poll(&distance)) == ULTRA_BUSY) {
+        sleep_us((uint32_t)(ultra_ready_us - time_us_64()));
+    }
+    return status == ULTRA_READY ? distance : 0;
 }
 
 // Function to initialize the ultrasonic sensor
+// Measurements should not start until the sensor has settled, ULTRA_SETTLE_US later.
 void ultra_init(){
     i2c_init(I2C_PORT, 100 * 1000); // Initialize I2C at 100kHz
     gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
     gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
     gpio_pull_up(SDA_PIN);
     gpio_pull_up(SCL_PIN);
+    ultra_settled_us = time_us_64() + ULTRA_SETTLE_US;
 }
 
-// Function to run ultrasonic sensor speed measurement
-void run_ultrasonic() {
-    // Only initialize once
-    static bool initialized = false;
-    if (!initialized) {
-        ultra_init();
-        printf("Starting ultrasonic speed measurement...\n");
-        sleep_ms(500); // Let sensor stabilize
-        initialized = true;
-    }
+// --- Speed measurement state
+static float speed_sum = 0.0f;
+static uint32_t speed_count = 0;
+static float top_speed = 0.0f;
 
-    // Static variables to keep state between calls
-    static uint16_t prev_dist = 0;
-    static absolute_time_t prev_time;
-    static bool first_run = true;
-    static float speed_sum = 0.0f;
-    static uint32_t speed_count = 0;
-    static float top_speed = 0.0f;
-    static absolute_time_t last_measurement = {0};
-
-    // Only measure every 400ms
-    absolute_time_t now = get_absolute_time();
-    if (!first_run && absolute_time_diff_us(last_measurement, now) < 400000) {
+// Update the speed statistics with a new distance reading
+static void ultra_process_sample(uint16_t curr_dist, uint64_t curr_time_us) {
+    // Glitches are dropped by the estimator and must not end a run
+    if (!speed_est_update(curr_dist, curr_time_us)) {
         return;
     }
-    last_measurement = now;
-
-    // Read current distance and time
-    uint16_t curr_dist = read_distance_mm();
-    absolute_time_t curr_time = get_absolute_time();
-
-    // If this is the first run, initialize previous values
-    if (first_run) {
-        prev_dist = curr_dist;
-        prev_time = curr_time;
-        first_run = false;
+    SpeedEstimate est = speed_est_get();
+    if (!est.valid) {
         return;
     }
-
-    // Calculate speed
-    float delta_dist = (curr_dist - prev_dist) / 1000.0f; // mm to m
-    float delta_time = absolute_time_diff_us(prev_time, curr_time) / 1e6f; // us to s
-
-    // Calculate speed only if delta_time is non-zero
-    float speed = 0.0f;
-    if (delta_time > 0) {
-        speed = delta_dist / delta_time; // m/s
-    }
+    float speed = est.velocity_mm_s / 1000.0f; // m/s
+    telemetry_batch_add(CHANNEL_DISTANCE, curr_dist);
+    telemetry_batch_add(CHANNEL_SPEED, (int32_t)est.velocity_mm_s);
 
     // Convert speed to cm/s for output
     if (speed > 0.5f) {
-        printf("Distance: %.1f cm, Speed: %.3f cm/s\n", curr_dist / 10.0f, speed);
+        LOG_VERBOSE(MODULE_ULTRASONIC, "Distance: %.1f cm, Speed: %.3f cm/s", est.position_mm / 10.0f, speed);
         speed_sum += speed;
         speed_count++;
         if (speed > top_speed) {
@@ -96,15 +137,84 @@ void run_ultrasonic() {
         if (speed_count > 0) {
             float avg_speed = speed_sum / speed_count;
             if (avg_speed > 0.5f) {
-                printf("Average Speed: %.3f cm/s\n", avg_speed);
-                printf("Top speed: %.3f cm/s\n", top_speed);
+                LOG_INFO(MODULE_ULTRASONIC, "Average Speed: %.3f cm/s", avg_speed);
+                LOG_INFO(MODULE_ULTRASONIC, "Top speed: %.3f cm/s", top_speed);
             }
             speed_sum = 0.0f;
             speed_count = 0;
             // top_speed is NOT reset, so it maintains the highest speed seen
         }
     }
-    // Update previous values for next iteration
-    prev_dist = curr_dist;
-    prev_time = curr_time;
-}
\ No newline at end of file
+}
+
+// Function to run ultrasonic sensor speed measurement
+// Takes one blocking measurement per call; ultra_start_tasks() measures asynchronously instead.
+void run_ultrasonic() {
+    uint64_t now = time_us_64();
+    if (now < ultra_settled_us) {
+        sleep_us((uint32_t)(ultra_settled_us - now)); // Let sensor stabilize
+    }
+
+    // Read current distance and time
+    uint64_t curr_time = time_us_64();
+    uint16_t curr_dist = read_distance_mm();
+    ultra_process_sample(curr_dist, curr_time);
+}
+
+// Task: collect the measurement, or come back when the sensor should be ready
+static void ultra_collect_task() {
+    ultra_collect_task_id = -1;
+    uint16_t distance;
+    switch (ultra_poll(&distance)) {
+        case ULTRA_READY:
+            ultra_process_sample(distance, ultra_trigger_us);
+            break;
+        case ULTRA_BUSY:
+            ultra_collect_task_id = sched_add_oneshot(ultra_collect_task, (uint32_t)(ultra_ready_us - time_us_64()));
+            break;
+        case ULTRA_ERROR:
+            LOG_WARNING(MODULE_ULTRASONIC, "Ultrasonic sensor did not respond");
+            break;
+        case ULTRA_IDLE:
+            break;
+    }
+}
+
+// Task: trigger a measurement and schedule its collection, so nothing waits for the sensor
+static void ultra_measure_task() {
+    if (ultra_busy) {
+        return; // The previous measurement is still being collected
+    }
+    if (ultra_start_measurement()) {
+        ultra_collect_task_id = sched_add_oneshot(ultra_collect_task, ULTRA_MEASURE_TIME_US);
+    }
+}
+
+// Task: start measuring periodically once the sensor has settled
+static void ultra_begin_task() {
+    ultra_task_id = sched_add_periodic(ultra_measure_task, ULTRA_PERIOD_US);
+}
+
+// Register the measurement task with the scheduler. Straight after boot, the first measurement waits for the sensor to
+// settle.
+void ultra_start_tasks() {
+    if (ultra_task_id >= 0) {
+        return;
+    }
+    LOG_INFO(MODULE_ULTRASONIC, "Starting ultrasonic speed measurement...");
+    uint64_t now = time_us_64();
+    if (now < ultra_settled_us) {
+        ultra_task_id = sched_add_oneshot(ultra_begin_task, (uint32_t)(ultra_settled_us - now));
+    } else {
+        ultra_begin_task();
+    }
+}
+
+void ultra_stop_tasks() {
+    sched_cancel(ultra_task_id);
+    sched_cancel(ultra_collect_task_id);
+    ultra_task_id = -1;
+    ultra_collect_task_id = -1;
+    ultra_busy = false;
+    speed_est_reset();
+}
@@ -1,7 +1,25 @@
 #pragma once
 
+#include <stdint.h>
+
+/// State of an asynchronous distance measurement.
+enum UltraStatus {
+    ULTRA_IDLE,  ///< No measurement in progress.
+    ULTRA_BUSY,  ///< Measurement started, result not available yet.
+    ULTRA_READY, ///< Result returned by this call.
+    ULTRA_ERROR, ///< The sensor never returned a result.
+};
+
 uint16_t read_distance_mm();
 
+bool ultra_start_measurement();
+
+UltraStatus ultra_poll(uint16_t *distance_mm);
+
 void ultra_init();
 
 void run_ultrasonic();
+
+void ultra_start_tasks();
+
+void ultra_stop_tasks();
@@ -1,27 +1,192 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "hardware/pio.h"
+#include "hardware/timer.h"
 #include "drivers/loadcell.h"
 #include "drivers/IR.h"
 #include "drivers/ultrasonic.h"
+#include "drivers/scheduler.h"
+#include "drivers/race_core.h"
+#include "drivers/tm1637.h"
+#include "drivers/command.h"
+#include "drivers/speed_estimator.h"
+#include "drivers/telemetry/telemetry.h"
+#include "drivers/telemetry/telemetry_batch.h"
+#include "drivers/uart_tx.h"
+#include "drivers/led_strip.h"
+#include "drivers/race_display.h"
 
 #include "WS2812.pio.h" 
 #include "drivers/logging/logging.h"
 
 #define BUTTON_PIN 15  // Change to your button's GPIO pin
+#define BUTTON_DEBOUNCE_US 50000 // Ignore bounces within 50 ms of a press
 #define UART_ID uart0 // UART ID for communication
 #define BAUD_RATE 115200 // Baud rate for UART communication
+#define TELEMETRY_WINDOW_MS 1000 // One batched telemetry record per second
 #define TX_PIN 0 // GPIO pin for UART TX
 #define RX_PIN 1 // GPIO pin for UART RX
+#define NUM_MODES 3 // Weighing, race and idle
 
 volatile bool button_pressed = false; // Flag to indicate button press
+static int current_mode = 0;
+static int requested_mode = -1; // Set by the "mode" command, applied by the main loop like a button press
+
+// Send a lap time to the Pi with the next telemetry batch, and show it on the LED strip
+static void report_lap(uint32_t lap_ms) {
+    telemetry_batch_add(CHANNEL_LAP, (int32_t)lap_ms);
+    race_display_lap(lap_ms);
+}
 
 // Interrupt handler function
 void button_irq_handler(uint gpio, uint32_t events) {
+    // The main loop no longer sleeps a fixed 10 ms between checks, so debounce on the press timestamps instead
+    static uint64_t last_press_us = 0;
     if (gpio == BUTTON_PIN && (events & GPIO_IRQ_EDGE_RISE)) {
-        button_pressed = true;
+        uint64_t now = time_us_64();
+        if (now - last_press_us >= BUTTON_DEBOUNCE_US) {
+            last_press_us = now;
+            button_pressed = true;
+        }
+    }
+}
+
+// Register the tasks for a mode with the scheduler
+static void start_mode(int mode) {
+    switch (mode) {
+        case 0:
+            lc_start_tasks();
+            break;
+        case 1:
+            ultra_start_tasks();
+            race_display_start_tasks();
+#if RACE_ON_CORE1
+            race_core_set_active(true);
+#else
+            ir_start_tasks();
+#endif
+            break;
+        case 2:
+            break;
+    }
+}
+
+// Remove the tasks for a mode from the scheduler
+static void stop_mode(int mode) {
+    switch (mode) {
+        case 0:
+            lc_stop_tasks();
+            break;
+        case 1:
+            ultra_stop_tasks();
+            race_display_stop_tasks();
+#if RACE_ON_CORE1
+            race_core_set_active(false);
+#else
+            ir_stop_tasks();
+#endif
+            break;
+        case 2:
+            break;
+    }
+}
+
+// Stop the current mode's tasks and start those of another
+static void switch_mode(int mode) {
+    stop_mode(current_mode);
+    current_mode = mode;
+    LOG_INFO(MODULE_MAIN, "Switched to mode %d", mode);
+
+    // Print mode name once when switching
+    if (mode == 0) {
+        LOG_INFO(MODULE_MAIN, "Entering Weighing mode");
+    } else if (mode == 1){
+        LOG_INFO(MODULE_MAIN, "Entering Race mode");
+    } else {
+        LOG_INFO(MODULE_MAIN, "Entering idle mode");
+    }
+    start_mode(mode);
+}
+
+// --- Console commands
+static const char *const mode_names[NUM_MODES] = {"weigh", "race", "idle"};
+static const char *const log_level_names[] = {"verbose", "info", "warning", "error"};
+static const char *const log_module_names[MODULE_COUNT] = {"main", "loadcell", "ir", "ultrasonic"};
+static const char *const batch_channel_names[CHANNEL_COUNT] = {"weight", "distance", "speed", "lap"};
+static const char *const batch_mode_names[] = {"off", "summary", "raw"};
+
+// Index of `word` in a table of names, or -1
+static int find_name(const char *word, const char *const *names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(word, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void command_mode(int argc, char **argv) {
+    int mode = argc == 2 ? find_name(argv[1], mode_names, NUM_MODES) : -1;
+    if (mode < 0) {
+        printf("ERR usage: mode <weigh|race|idle>\n");
+        return;
     }
+    requested_mode = mode;
+    printf("OK mode %s\n", mode_names[mode]);
+}
+
+static void command_loglevel(int argc, char **argv) {
+    int level = argc >= 2 ? find_name(argv[argc - 1], log_level_names, sizeof(log_level_names) / sizeof(log_level_names[0])) : -1;
+    int module = argc == 3 ? find_name(argv[1], log_module_names, MODULE_COUNT) : -1;
+    if (level < 0 || argc > 3 || (argc == 3 && module < 0)) {
+        printf("ERR usage: loglevel [main|loadcell|ir|ultrasonic] <verbose|info|warning|error>\n");
+        return;
+    }
+    if (argc == 3) {
+        setModuleLogLevel((LogModule)module, (LogLevel)level);
+    } else {
+        setLogLevel((LogLevel)level);
+    }
+    printf("OK loglevel %s\n", log_level_names[level]);
+}
+
+static void command_window(int argc, char **argv) {
+    // Check the range before narrowing, so an out-of-range number can't wrap into an accepted one
+    char *end = nullptr;
+    unsigned long window_ms = argc == 2 && argv[1][0] != '-' ? strtoul(argv[1], &end, 10) : 0;
+    if (end == argv[1] || (end != nullptr && *end != '\0') || window_ms < 10 || window_ms > 65535) {
+        printf("ERR usage: window <ms>, 10 to 65535\n");
+        return;
+    }
+    telemetry_batch_set_window((uint32_t)window_ms);
+    printf("OK window %lu\n", window_ms);
+}
+
+static void command_batch(int argc, char **argv) {
+    int channel = argc == 3 ? find_name(argv[1], batch_channel_names, CHANNEL_COUNT) : -1;
+    int mode = argc == 3 ? find_name(argv[2], batch_mode_names, sizeof(batch_mode_names) / sizeof(batch_mode_names[0])) : -1;
+    if (channel < 0 || mode < 0) {
+        printf("ERR usage: batch <weight|distance|speed|lap> <off|summary|raw>\n");
+        return;
+    }
+    telemetry_batch_set_mode((TelemetryChannel)channel, (TelemetryBatchMode)mode);
+    printf("OK batch %s %s\n", batch_channel_names[channel], batch_mode_names[mode]);
+}
+
+static void command_stats(int argc, char **argv) {
+    UartTxStats tx = uart_tx_stats();
+    LedStripStats leds = led_strip_stats();
+    printf("OK mode=%s uptime_ms=%lu telemetry=%lu uart_queued=%lu uart_dropped=%lu uart_high_water=%lu "
+           "log_dropped=%lu rx_overruns=%lu lc_rejected=%lu speed_rejected=%lu led_frames=%lu led_skipped=%lu\n",
+           mode_names[current_mode], (unsigned long)to_ms_since_boot(get_absolute_time()),
+           (unsigned long)telemetry_records_sent(), (unsigned long)tx.records_queued,
+           (unsigned long)tx.records_dropped, (unsigned long)tx.high_water, (unsigned long)logDroppedCount(),
+           (unsigned long)command_rx_overruns(), (unsigned long)lc_filter_rejected_count(),
+           (unsigned long)speed_est_rejected_count(), (unsigned long)leds.frames_shown,
+           (unsigned long)leds.frames_skipped);
 }
 
 int main() {
@@ -29,12 +194,15 @@ int main() {
     // Initialise LCDs, and ultrasonic sensor 
     hx711_init();  
     ultra_init();
-    tm1637_init();
+    tm1637_main_display.init();
+    tm1637_lap_display.init();
+    race_display_init();
 
     // Initialize UART
     uart_init(UART_ID, BAUD_RATE);
     gpio_set_function(TX_PIN, GPIO_FUNC_UART);
     gpio_set_function(RX_PIN, GPIO_FUNC_UART);
+    uart_tx_init(UART_ID, UART_TX_BLOCK); // printf, logs and telemetry no longer stall on the UART
 
     // Initialize button GPIO
     gpio_init(BUTTON_PIN);
@@ -43,43 +211,52 @@ int main() {
     // Set up interrupt on rising edge (button press)
     gpio_set_irq_enabled_with_callback(BUTTON_PIN, GPIO_IRQ_EDGE_RISE, true, &button_irq_handler);
 
-    int mode = 0; // State variable for toggling functions
-    const int NUM_MODES = 3; // Change this to the number of functions you want to toggle
+    // Deferred log messages from both cores are printed from core 0
+    logStartDrainTask();
+    telemetry_batch_start(TELEMETRY_WINDOW_MS);
+
+    // Runtime configuration from the Pi, without blocking on console input
+    command_init(UART_ID);
+    command_register("mode", "mode <weigh|race|idle>", command_mode);
+    command_register("loglevel", "loglevel [module] <level>", command_loglevel);
+    command_register("window", "window <ms>", command_window);
+    command_register("batch", "batch <channel> <off|summary|raw>", command_batch);
+    command_register("stats", "stats", command_stats);
+    lc_register_commands();
+
+#if RACE_ON_CORE1
+    // The lap timer gets core 1 to itself, so blocking work on core 0 can't delay beam sampling
+    race_core_launch();
+#else
+    // Laps are timed on this core, so they can go straight into the batch
+    ir_set_lap_callback(report_lap);
+#endif
+
+    start_mode(current_mode);
 
      while (true) {
         // Check if button was pressed
         if (button_pressed) {
             button_pressed = false;
-            mode = (mode + 1) % NUM_MODES; // Cycle through modes
-            printf("Button pressed! Switched to mode %d\n", mode);
-            
-            // Print mode name once when switching
-            if (mode == 0) {
-                printf("Entering Weighing mode\n");
-            } else if (mode == 1){
-                printf("Entering Race mode\n");
-            } else {
-                printf("Entering idle mode\n");
-            }
+            LOG_INFO(MODULE_MAIN, "Button pressed!");
+            switch_mode((current_mode + 1) % NUM_MODES); // Cycle through modes
+        }
+        if (requested_mode >= 0) {
+            switch_mode(requested_mode);
+            requested_mode = -1;
         }
 
-        // Call different functions based on mode
-        switch (mode) {
-            case 0:
-                lc_calibrate_send();
-                break;
-            case 1:
-                run_ultrasonic();
-                run_IR();
-                break;
-            case 2:
-                break;
+#if RACE_ON_CORE1
+        // Lap events from core 1
+        uint32_t lap_ms;
+        while (race_core_poll_lap(&lap_ms)) {
+            LOG_INFO(MODULE_MAIN, "Lap reported by core 1: %lu ms", (unsigned long)lap_ms);
+            report_lap(lap_ms);
         }
-        sleep_ms(10); // Debounce delay
+#endif
+
+        // Run whatever the active drivers have due, then sleep until the next deadline, the button or console input
+        sched_run_pending();
+        sched_wait();
     }
 }
-
-      
-
-
-    
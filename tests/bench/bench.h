@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Helpers shared by the host benchmarks. They measure CPU time on the calling thread, so time spent asleep in the mock
+// clock (waiting for a simulated FIFO, say) does not count towards the cost of the code being measured.
+
+/// CPU time used by the calling thread, in nanoseconds.
+static inline uint64_t bench_cpu_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/// Keep the compiler from optimising away a result the benchmark does not otherwise use.
+template <typename T>
+static inline void bench_keep(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
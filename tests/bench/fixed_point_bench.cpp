@@ -0,0 +1,77 @@
+// Host benchmark: the Q24 fixed-point weight conversion against the float path it replaced.
+//
+// Every raw reading in a sweep of the HX711's 24-bit range is converted both ways for a few calibration factors, and
+// each result is compared with a double-precision reference. The fixed-point path returns whole grams, so up to 0.5 g
+// of its error is rounding; the run fails if it is ever more than 1 g out. Host timings only show the relative cost: on
+// the Cortex-M0+ the float path also pays for a soft-float divide.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "drivers/loadcell.h"
+#include "bench/bench.h"
+
+#define BENCH_SAMPLES 1000000
+#define BENCH_MAX_ERROR_G 1.0
+
+// Counts per kg: a sensitive cell, a typical bar cell, and a low-gain setup wired backwards
+static const float bench_factors[] = {420000.0f, 22800.0f, -1050.0f};
+static const int32_t bench_tare = -123456;
+
+int main()
+{
+    std::vector<int32_t> raw(BENCH_SAMPLES);
+    for (size_t i = 0; i < raw.size(); i++) {
+        raw[i] = -0x800000 + (int32_t)(i * (0x1000000 / BENCH_SAMPLES));
+    }
+
+    bool ok = true;
+    for (float factor : bench_factors) {
+        int64_t scale_q24 = lc_scale_from_factor(factor);
+
+        double fixed_error = 0, float_error = 0;
+        for (int32_t r : raw) {
+            double reference = (double)(r - bench_tare) * 1000.0 / factor;
+            double fixed_g = hx711_get_weight_g(r, bench_tare, scale_q24);
+            double float_g = hx711_get_weight_kg((uint32_t)r, (uint32_t)bench_tare, factor) * 1000.0;
+            fixed_error = fmax(fixed_error, fabs(fixed_g - reference));
+            float_error = fmax(float_error, fabs(float_g - reference));
+        }
+
+        uint64_t start = bench_cpu_ns();
+        int64_t fixed_sum = 0;
+        for (int32_t r : raw) {
+            fixed_sum += hx711_get_weight_g(r, bench_tare, scale_q24);
+        }
+        uint64_t fixed_ns = bench_cpu_ns() - start;
+        bench_keep(fixed_sum);
+
+        start = bench_cpu_ns();
+        float float_sum = 0;
+        for (int32_t r : raw) {
+            float_sum += hx711_get_weight_kg((uint32_t)r, (uint32_t)bench_tare, factor);
+        }
+        uint64_t float_ns = bench_cpu_ns() - start;
+        bench_keep(float_sum);
+
+        printf("factor %10.1f counts/kg: fixed %.2f ns/sample, max error %.3f g; float %.2f ns/sample, max error %.3f g\n",
+               factor, (double)fixed_ns / raw.size(), fixed_error, (double)float_ns / raw.size(), float_error);
+        if (fixed_error > BENCH_MAX_ERROR_G) {
+            printf("FAIL: fixed-point error above %.1f g\n", BENCH_MAX_ERROR_G);
+            ok = false;
+        }
+    }
+
+    // Unusable factors must be refused rather than turned into a scale
+    const float bad_factors[] = {0.0f, -0.0f, 1e-6f, NAN, INFINITY};
+    for (float factor : bad_factors) {
+        if (lc_scale_factor_valid(factor)) {
+            printf("FAIL: factor %g accepted\n", factor);
+            ok = false;
+        }
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
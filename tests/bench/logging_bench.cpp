@@ -0,0 +1,106 @@
+// Host benchmark: per-call latency of deferred logging against the synchronous log() it replaced.
+//
+// The synchronous path formats the message and prints it before returning; on the board the caller then also waits for
+// the UART to send every byte, which is reported separately from the line length at 115200 baud. The deferred path only
+// captures the arguments into the ring. Output goes to /dev/null while timing, so the terminal does not count. The run
+// fails if a deferred call is not cheaper than a synchronous one, or if a full ring does not count its drops.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hardware/uart.h"
+#include "drivers/logging/logging.h"
+#include "drivers/uart_tx.h"
+#include "bench/bench.h"
+
+#define BENCH_ROUNDS 20000
+#define BENCH_BATCH 16 // Deferred calls between drains, well inside the ring
+#define BENCH_UART_BAUD 115200
+#define BENCH_RING_SIZE 32 // LOG_RING_SIZE in logging.cpp
+
+static int bench_stdout = -1;
+
+// Send stdout to /dev/null while timing
+static void bench_mute()
+{
+    fflush(stdout);
+    bench_stdout = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+}
+
+static void bench_unmute()
+{
+    fflush(stdout);
+    dup2(bench_stdout, STDOUT_FILENO);
+    close(bench_stdout);
+}
+
+int main()
+{
+    setLogLevel(LogLevel::VERBOSE);
+#if LOG_BINARY
+    // Binary records are drained straight into the UART queue
+    uart_init(uart0, BENCH_UART_BAUD);
+    uart_tx_init(uart0, UART_TX_DROP_NEWEST);
+#endif
+    const char *fmt = "Lap %d completed: %lu.%03lu s, speed %.3f m/s";
+
+    // Synchronous: format, then print, as every log call did before deferred logging
+    bench_mute();
+    char line[128];
+    int length = 0;
+    uint64_t start = bench_cpu_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        length = snprintf(line, sizeof(line), fmt, i, (unsigned long)(i / 1000), (unsigned long)(i % 1000), 1.25);
+        log(LogLevel::INFORMATION, line);
+    }
+    uint64_t sync_ns = bench_cpu_ns() - start;
+
+    // Deferred: only the calls are timed, not the drain that prints them
+    uint64_t deferred_ns = 0;
+    uint32_t dropped = logDroppedCount();
+    for (int i = 0; i < BENCH_ROUNDS; i += BENCH_BATCH) {
+        start = bench_cpu_ns();
+        for (int j = i; j < i + BENCH_BATCH; j++) {
+            LOG_INFO(MODULE_MAIN, "Lap %d completed: %lu.%03lu s, speed %.3f m/s", j, (unsigned long)(j / 1000),
+                     (unsigned long)(j % 1000), 1.25);
+        }
+        deferred_ns += bench_cpu_ns() - start;
+        logDrain(BENCH_BATCH);
+    }
+    bool no_drops = logDroppedCount() == dropped;
+
+    // Overfill the ring: everything past its size must be counted as dropped
+    for (int i = 0; i < BENCH_RING_SIZE + 8; i++) {
+        LOG_INFO(MODULE_MAIN, "Overflow %d", i);
+    }
+    uint32_t overflow_drops = logDroppedCount() - dropped;
+    logDrain(BENCH_RING_SIZE);
+    bench_unmute();
+
+    double sync_call_ns = (double)sync_ns / BENCH_ROUNDS;
+    double deferred_call_ns = (double)deferred_ns / BENCH_ROUNDS;
+    double uart_us = (length + 24) * 10 * 1e6 / BENCH_UART_BAUD; // Message plus the "[t level]: " prefix and newline
+    printf("synchronous: %.0f ns per call formatting and printing, plus %.0f us waiting for the UART on the board\n",
+           sync_call_ns, uart_us);
+    printf("deferred:    %.0f ns per call\n", deferred_call_ns);
+
+    bool ok = true;
+    if (!no_drops) {
+        printf("FAIL: records dropped while draining every %d calls\n", BENCH_BATCH);
+        ok = false;
+    }
+    if (overflow_drops != 8) {
+        printf("FAIL: overfilling the ring by 8 counted %lu drops\n", (unsigned long)overflow_drops);
+        ok = false;
+    }
+    if (deferred_call_ns >= sync_call_ns) {
+        printf("FAIL: deferred calls are not cheaper than synchronous ones\n");
+        ok = false;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,73 @@
+// Host benchmark: the cost of simulating long WS2812 strips in the harness.
+//
+// Frames of several thousand LEDs are written word by word to the mocked state machine, as a CPU-fed strip would be,
+// with a latch gap between frames. Only CPU time on the writing thread counts, not the time it spends held back by the
+// simulated FIFO. The run fails unless every word is captured, in order. In virtual time each frame must also latch
+// whole; in real time a late wake-up from the FIFO wait idles the line long enough to latch, as a stalled CPU would on
+// the board, so frames may be split there.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "WS2812.pio.h"
+#include "bench/bench.h"
+
+#define BENCH_PIN 22
+#define BENCH_LEDS 4096
+#define BENCH_FRAMES 8
+#define BENCH_LATCH_US 300
+
+// A colour that differs between LEDs and frames, GRB in the top 24 bits
+static uint32_t bench_colour(unsigned int frame, unsigned int led)
+{
+    return ((led * 7 + frame) & 0xFFFFFF) << 8;
+}
+
+int main()
+{
+    PIO pio = pio0;
+    unsigned int offset = pio_add_program(pio, &ws2812_program);
+    unsigned int sm = pio_claim_unused_sm(pio, true);
+    ws2812_program_init(pio, sm, offset, BENCH_PIN, 800000, false);
+
+    uint64_t cpu_ns = 0;
+    for (unsigned int frame = 0; frame < BENCH_FRAMES; frame++) {
+        uint64_t start = bench_cpu_ns();
+        for (unsigned int led = 0; led < BENCH_LEDS; led++) {
+            pio_sm_put_blocking(pio, sm, bench_colour(frame, led));
+        }
+        cpu_ns += bench_cpu_ns() - start;
+
+        // Wait for the FIFO to drain and the strip to latch
+        sleep_us(8 * 30 + BENCH_LATCH_US);
+    }
+
+    // Every word, in order, across however many frames latched
+    bool ok = true;
+    size_t frames = mock_ws2812_frame_count();
+    size_t words = 0;
+    for (size_t i = 0; ok && i < frames; i++) {
+        MockWs2812Frame captured;
+        ok = mock_ws2812_get_frame(i, captured);
+        for (size_t j = 0; ok && j < captured.leds.size(); j++, words++) {
+            ok = words < BENCH_FRAMES * BENCH_LEDS &&
+                 captured.leds[j] == bench_colour(words / BENCH_LEDS, words % BENCH_LEDS);
+        }
+    }
+    if (!ok || words != BENCH_FRAMES * BENCH_LEDS) {
+        printf("FAIL: the capture does not hold the %d words sent, in order\n", BENCH_FRAMES * BENCH_LEDS);
+        ok = false;
+    }
+#if MOCK_VIRTUAL_TIME
+    if (frames != BENCH_FRAMES) {
+        printf("FAIL: %zu frames latched, %d sent\n", frames, BENCH_FRAMES);
+        ok = false;
+    }
+#endif
+
+    printf("%d frames of %d LEDs: %.1f ns of CPU per LED, %.3f ms per frame\n", BENCH_FRAMES, BENCH_LEDS,
+           (double)cpu_ns / (BENCH_FRAMES * BENCH_LEDS), cpu_ns / 1e6 / BENCH_FRAMES);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+#include "hardware/pio.h"
+
+extern pio_program_t hx711_program;
+
+void hx711_program_init(PIO pio, unsigned int sm, unsigned int offset, unsigned int dout_pin, unsigned int sck_pin);
+
+// Test harness hook: deliver a conversion result as if the state machine had clocked it out of the HX711.
+void mock_hx711_push_sample(int32_t value);
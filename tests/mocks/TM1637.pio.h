@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+#include "hardware/pio.h"
+
+extern pio_program_t tm1637_program;
+
+// Build a FIFO word for tm1637_program: bit 0 start, bits 1-8 inverted data, bit 9 stop
+static inline uint32_t tm1637_word(uint8_t data, bool start, bool stop) {
+    return (start ? 1u : 0u) | ((uint32_t)(uint8_t)~data << 1) | (stop ? 1u << 9 : 0u);
+}
+
+void tm1637_program_init(PIO pio, unsigned int sm, unsigned int offset, unsigned int dio_pin, unsigned int clk_pin);
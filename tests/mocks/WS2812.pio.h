@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "hardware/pio.h"
+
+extern pio_program_t ws2812_program;
+
+void ws2812_program_init(PIO pio, unsigned int sm, unsigned int offset, unsigned int pin, float freq, bool rgbw);
+
+/// A frame as the strip latched it.
+struct MockWs2812Frame {
+    uint64_t latch_us;           // Mock clock time at which the strip latched
+    std::vector<uint32_t> leds;  // The words written to the state machine, GRB colour in the top 24 bits
+};
+
+/// Test harness hook: the number of frames the strip has latched so far.
+size_t mock_ws2812_frame_count();
+
+/// Test harness hook: copy out latched frame `index`, counting from 0. Returns false if it hasn't latched yet.
+bool mock_ws2812_get_frame(size_t index, MockWs2812Frame &frame);
+
+/// Test harness hook: copy out the most recently latched frame. Returns false if none has latched.
+bool mock_ws2812_latest_frame(MockWs2812Frame &frame);
@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <mutex>
+
+#include "bus_trace.h"
+#include "mock_clock.h"
+
+#define MOCK_BUS_NUM_PINS 30
+
+// Recording stops here (16 MB), and later edges are only counted. The report then only covers the time before the
+// earliest dropped edge, since every edge up to then was recorded.
+#define MOCK_BUS_MAX_EDGES (1u << 20)
+
+// WS2812 timing: a high pulse longer than this is a 1, and a low gap of MOCK_WS2812_LATCH_NS latches the frame
+#define WS2812_ONE_THRESHOLD_NS 625
+
+struct MockBus {
+    MockBusType type;
+    unsigned int pin_a;
+    unsigned int pin_b;
+};
+
+static std::mutex trace_mutex;
+static int trace_enabled = -1; // Not yet read from the environment
+static std::vector<MockBusEdge> trace_edges;
+static size_t trace_dropped = 0;
+static uint64_t trace_dropped_from_ns = UINT64_MAX;
+static uint8_t trace_levels[MOCK_BUS_NUM_PINS];
+static bool trace_levels_known[MOCK_BUS_NUM_PINS];
+static std::vector<MockBus> trace_buses;
+
+bool mock_bus_trace_enabled()
+{
+    std::lock_guard<std::mutex> guard(trace_mutex);
+    if (trace_enabled < 0) {
+        trace_enabled = getenv("MOCK_BUS_TRACE") != nullptr;
+    }
+    return trace_enabled;
+}
+
+void mock_bus_trace_enable(bool enabled)
+{
+    std::lock_guard<std::mutex> guard(trace_mutex);
+    trace_enabled = enabled;
+}
+
+void mock_bus_trace_edge(unsigned int pin, bool level, uint64_t time_ns)
+{
+    if (pin >= MOCK_BUS_NUM_PINS || !mock_bus_trace_enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(trace_mutex);
+    if (trace_levels_known[pin] && trace_levels[pin] == level) {
+        return;
+    }
+    trace_levels[pin] = level;
+    trace_levels_known[pin] = true;
+    if (trace_edges.size() >= MOCK_BUS_MAX_EDGES) {
+        trace_dropped++;
+        trace_dropped_from_ns = std::min(trace_dropped_from_ns, time_ns);
+        return;
+    }
+    trace_edges.push_back({time_ns, (uint8_t)pin, (uint8_t)level});
+}
+
+void mock_bus_register(MockBusType type, unsigned int pin_a, unsigned int pin_b)
+{
+    if (!mock_bus_trace_enabled()) {
+        return;
+    }
+    bool first;
+    {
+        std::lock_guard<std::mutex> guard(trace_mutex);
+        first = trace_buses.empty();
+        trace_buses.push_back({type, pin_a, pin_b});
+    }
+    if (first) {
+        mock_clock_on_exit(mock_bus_report);
+    }
+
+    // Idle levels, so the decoders start from a known state
+    uint64_t now_ns = mock_clock_now_us() * 1000;
+    switch (type) {
+    case MOCK_BUS_TM1637:
+        mock_bus_trace_edge(pin_a, true, now_ns);
+        mock_bus_trace_edge(pin_b, true, now_ns);
+        break;
+    case MOCK_BUS_HX711:
+        mock_bus_trace_edge(pin_a, false, now_ns);
+        mock_bus_trace_edge(pin_b, true, now_ns);
+        break;
+    case MOCK_BUS_WS2812:
+        mock_bus_trace_edge(pin_a, false, now_ns);
+        break;
+    }
+}
+
+std::vector<MockBusEdge> mock_bus_trace_pin(unsigned int pin)
+{
+    std::vector<MockBusEdge> edges;
+    {
+        std::lock_guard<std::mutex> guard(trace_mutex);
+        for (const MockBusEdge &edge : trace_edges) {
+            if (edge.pin == pin) {
+                edges.push_back(edge);
+            }
+        }
+    }
+    std::stable_sort(edges.begin(), edges.end(),
+                     [](const MockBusEdge &a, const MockBusEdge &b) { return a.time_ns < b.time_ns; });
+    return edges;
+}
+
+// Edges of a clock and a data pin in time order. A clock edge and a data edge at the same instant are ordered as the
+// receiver sees them: data changes after the clock falls and before it rises.
+static std::vector<MockBusEdge> trace_clock_and_data(unsigned int clk_pin, unsigned int data_pin)
+{
+    std::vector<MockBusEdge> edges = mock_bus_trace_pin(clk_pin);
+    std::vector<MockBusEdge> data = mock_bus_trace_pin(data_pin);
+    edges.insert(edges.end(), data.begin(), data.end());
+    auto rank = [clk_pin](const MockBusEdge &edge) { return edge.pin != clk_pin ? 1 : edge.level ? 2 : 0; };
+    std::stable_sort(edges.begin(), edges.end(), [&rank](const MockBusEdge &a, const MockBusEdge &b) {
+        return a.time_ns != b.time_ns ? a.time_ns < b.time_ns : rank(a) < rank(b);
+    });
+    return edges;
+}
+
+// Transfers run from a start condition (DIO falls while CLK is high) to a stop condition (DIO rises while CLK is
+// high). Bits are sampled on the rising clock edge, LSB first, and every ninth clock is the ACK.
+std::vector<MockBusTransaction> mock_bus_decode_tm1637(unsigned int clk_pin, unsigned int dio_pin)
+{
+    std::vector<MockBusTransaction> transactions;
+    MockBusTransaction current;
+    bool clk = true;
+    bool dio = true;
+    bool in_transfer = false;
+    unsigned int bit = 0;
+    uint32_t byte = 0;
+
+    for (const MockBusEdge &edge : trace_clock_and_data(clk_pin, dio_pin)) {
+        if (edge.pin == dio_pin) {
+            dio = edge.level;
+            if (!clk) {
+                continue;
+            }
+            if (!dio) {
+                current = {edge.time_ns, edge.time_ns, {}};
+                in_transfer = true;
+                bit = 0;
+                byte = 0;
+            } else if (in_transfer) {
+                current.end_ns = edge.time_ns;
+                transactions.push_back(current);
+                in_transfer = false;
+            }
+        } else {
+            clk = edge.level;
+            if (!clk || !in_transfer) {
+                continue;
+            }
+            if (bit < 8) {
+                byte |= (uint32_t)dio << bit;
+                bit++;
+            } else {
+                current.data.push_back(byte);
+                bit = 0;
+                byte = 0;
+            }
+        }
+    }
+    return transactions;
+}
+
+// A conversion starts when DOUT falls while SCK is low, and is clocked out MSB first, sampled while SCK is high. The
+// pulses after the 24th select the next channel and gain. Each transaction's data is the raw 24-bit result followed by
+// the number of SCK pulses.
+std::vector<MockBusTransaction> mock_bus_decode_hx711(unsigned int sck_pin, unsigned int dout_pin)
+{
+    std::vector<MockBusTransaction> transactions;
+    MockBusTransaction current;
+    bool sck = false;
+    bool dout = true;
+    bool in_conversion = false;
+    uint32_t value = 0;
+    uint32_t pulses = 0;
+
+    auto finish = [&]() {
+        if (in_conversion && pulses > 0) {
+            current.data = {value, pulses};
+            transactions.push_back(current);
+        }
+        in_conversion = false;
+    };
+
+    for (const MockBusEdge &edge : trace_clock_and_data(sck_pin, dout_pin)) {
+        if (edge.pin == dout_pin) {
+            dout = edge.level;
+            // DOUT only falls with SCK low once the previous conversion has been clocked out, or at the first one
+            if (!dout && !sck && (!in_conversion || pulses >= 24)) {
+                finish();
+                current = {edge.time_ns, edge.time_ns, {}};
+                in_conversion = true;
+                value = 0;
+                pulses = 0;
+            }
+        } else {
+            sck = edge.level;
+            if (!in_conversion) {
+                continue;
+            }
+            if (sck) {
+                pulses++;
+            } else {
+                if (pulses <= 24) {
+                    value = (value << 1) | dout;
+                }
+                current.end_ns = edge.time_ns;
+            }
+        }
+    }
+    finish();
+    return transactions;
+}
+
+// Each bit is a high pulse, long for a 1 and short for a 0, and a long low gap latches the frame.
+std::vector<MockBusTransaction> mock_bus_decode_ws2812(unsigned int pin, unsigned int bits_per_led)
+{
+    std::vector<MockBusTransaction> transactions;
+    MockBusTransaction current;
+    bool in_frame = false;
+    uint64_t rise_ns = 0;
+    uint64_t fall_ns = 0;
+    uint32_t word = 0;
+    unsigned int bits = 0;
+
+    for (const MockBusEdge &edge : mock_bus_trace_pin(pin)) {
+        if (edge.level) {
+            if (in_frame && edge.time_ns - fall_ns >= MOCK_WS2812_LATCH_NS) {
+                current.end_ns = fall_ns;
+                transactions.push_back(current);
+                in_frame = false;
+            }
+            if (!in_frame) {
+                current = {edge.time_ns, edge.time_ns, {}};
+                in_frame = true;
+                word = 0;
+                bits = 0;
+            }
+            rise_ns = edge.time_ns;
+        } else if (in_frame) {
+            word = (word << 1) | (edge.time_ns - rise_ns > WS2812_ONE_THRESHOLD_NS);
+            if (++bits == bits_per_led) {
+                current.data.push_back(word);
+                word = 0;
+                bits = 0;
+            }
+            fall_ns = edge.time_ns;
+        }
+    }
+    if (in_frame) {
+        current.end_ns = fall_ns;
+        transactions.push_back(current);
+    }
+    return transactions;
+}
+
+void mock_bus_report(uint64_t end_us)
+{
+    std::vector<MockBus> buses;
+    uint64_t window_ns = end_us * 1000;
+    {
+        std::lock_guard<std::mutex> guard(trace_mutex);
+        buses = trace_buses;
+        fprintf(stderr, "Debug: bus trace holds %zu edges (%zu dropped)\n", trace_edges.size(), trace_dropped);
+        if (trace_dropped > 0 && trace_dropped_from_ns < window_ns) {
+            window_ns = trace_dropped_from_ns;
+            fprintf(stderr, "Debug: bus trace filled up at %.6f s of %.6f s; the figures below only cover the run up "
+                            "to then\n", window_ns / 1e9, end_us / 1e6);
+        }
+    }
+
+    for (const MockBus &bus : buses) {
+        std::vector<MockBusTransaction> transactions;
+        switch (bus.type) {
+        case MOCK_BUS_TM1637:
+            transactions = mock_bus_decode_tm1637(bus.pin_a, bus.pin_b);
+            fprintf(stderr, "Debug: TM1637 CLK=%u DIO=%u: %zu transfers", bus.pin_a, bus.pin_b, transactions.size());
+            break;
+        case MOCK_BUS_HX711:
+            transactions = mock_bus_decode_hx711(bus.pin_a, bus.pin_b);
+            fprintf(stderr, "Debug: HX711 SCK=%u DOUT=%u: %zu conversions", bus.pin_a, bus.pin_b, transactions.size());
+            break;
+        case MOCK_BUS_WS2812:
+            transactions = mock_bus_decode_ws2812(bus.pin_a, bus.pin_b);
+            fprintf(stderr, "Debug: WS2812 DIN=%u: %zu frames", bus.pin_a, transactions.size());
+            break;
+        }
+
+        // Transactions that ran past the end of the recording are incomplete. The decoders return the one in progress
+        // when the trace ends, so a WS2812 frame also needs its latch gap inside the window, and an HX711 conversion
+        // all of its data bits.
+        size_t total = transactions.size();
+        MockBusType type = bus.type;
+        auto incomplete = [window_ns, type](const MockBusTransaction &t) {
+            switch (type) {
+            case MOCK_BUS_HX711:
+                return t.end_ns > window_ns || t.data[1] < 25;
+            case MOCK_BUS_WS2812:
+                return t.end_ns + MOCK_WS2812_LATCH_NS > window_ns;
+            default:
+                return t.end_ns > window_ns;
+            }
+        };
+        transactions.erase(std::remove_if(transactions.begin(), transactions.end(), incomplete), transactions.end());
+        if (transactions.size() != total) {
+            fprintf(stderr, " (%zu in the recorded window)", transactions.size());
+        }
+
+        uint64_t busy_ns = 0;
+        uint64_t longest_ns = 0;
+        for (const MockBusTransaction &transaction : transactions) {
+            uint64_t duration = transaction.end_ns - transaction.start_ns;
+            busy_ns += duration;
+            longest_ns = std::max(longest_ns, duration);
+        }
+        double mean_us = transactions.empty() ? 0 : busy_ns / 1e3 / transactions.size();
+        double utilisation = window_ns == 0 ? 0 : 100.0 * busy_ns / window_ns;
+        fprintf(stderr, ", %.3f ms on the wire (%.3f%% busy), mean %.1f us, longest %.1f us\n",
+                busy_ns / 1e6, utilisation, mean_us, longest_ns / 1e3);
+    }
+}
+
+void MockBusWriter::begin()
+{
+    time_ns = std::max(time_ns, mock_clock_now_us() * 1000);
+}
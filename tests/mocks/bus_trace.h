@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Pin-level bus recorder for the harness.
+//
+// With MOCK_BUS_TRACE set in the environment, the GPIO mock and the mocked PIO programs record every level change
+// they would put on the wire into one in-memory trace, timestamped in nanoseconds of mock clock time. The PIO mocks
+// synthesise the waveform their real program produces (same clock dividers and delays), queueing words back to back
+// while the state machine is busy. Decoders turn the trace back into bus transactions, and when the simulation ends
+// a report gives the number of transactions, their duration and the share of time each bus was busy.
+
+/// One level change on a pin. Kept to 16 bytes, as a long run records millions of them.
+struct MockBusEdge {
+    uint64_t time_ns;
+    uint8_t pin;
+    uint8_t level;
+};
+
+/// A decoded transaction: a TM1637 start-to-stop transfer, an HX711 conversion, or a WS2812 frame.
+struct MockBusTransaction {
+    uint64_t start_ns;
+    uint64_t end_ns;
+    std::vector<uint32_t> data; // TM1637 bytes, HX711 result and SCK pulse count, or WS2812 colours (right aligned)
+};
+
+/// Low time after which a WS2812 strip latches the frame (280 us for the WS2812B). The WS2812 mock cuts its captured
+/// frames at the same point as the decoder.
+#define MOCK_WS2812_LATCH_NS 280000
+
+enum MockBusType {
+    MOCK_BUS_TM1637,
+    MOCK_BUS_HX711,
+    MOCK_BUS_WS2812,
+};
+
+/// True if recording is on: MOCK_BUS_TRACE is set, or mock_bus_trace_enable() was called.
+bool mock_bus_trace_enabled();
+
+void mock_bus_trace_enable(bool enabled);
+
+/// Record `pin` going to `level` at `time_ns`. Repeats of the pin's current level are ignored.
+void mock_bus_trace_edge(unsigned int pin, bool level, uint64_t time_ns);
+
+/// Name the pins of a bus, so the report knows which decoder to run on them. `pin_a` is CLK, SCK or the WS2812 data
+/// pin; `pin_b` is DIO or DOUT. For WS2812, `pin_b` is the bits per LED instead (24 or 32).
+void mock_bus_register(MockBusType type, unsigned int pin_a, unsigned int pin_b);
+
+/// A copy of the recorded edges of one pin, in time order.
+std::vector<MockBusEdge> mock_bus_trace_pin(unsigned int pin);
+
+std::vector<MockBusTransaction> mock_bus_decode_tm1637(unsigned int clk_pin, unsigned int dio_pin);
+std::vector<MockBusTransaction> mock_bus_decode_hx711(unsigned int sck_pin, unsigned int dout_pin);
+std::vector<MockBusTransaction> mock_bus_decode_ws2812(unsigned int pin, unsigned int bits_per_led);
+
+/// Print the per-bus statistics to stderr, taking `end_us` as the length of the run. If the trace filled up, they only
+/// cover the time before the first edge that could not be recorded, and the report says so.
+void mock_bus_report(uint64_t end_us);
+
+/// Waveform generator for a mocked PIO program. The state machine's own time runs ahead of the mock clock while
+/// words are queued in its FIFO, and catches up with it when the program stalls.
+struct MockBusWriter {
+    uint64_t time_ns = 0;
+
+    /// The program takes a new word: it starts now, or when it finishes the previous one.
+    void begin();
+
+    void set(unsigned int pin, bool level) {
+        mock_bus_trace_edge(pin, level, time_ns);
+    }
+
+    void wait(uint64_t ns) {
+        time_ns += ns;
+    }
+};
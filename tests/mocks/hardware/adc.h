@@ -0,0 +1,4 @@
+#pragma once
+
+// Included by the drivers, which don't use the ADC yet
+void adc_init();
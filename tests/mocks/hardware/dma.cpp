@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "mock_clock.h"
+
+// Each channel's transfers are carried out by its own thread, so they run alongside the code that started them
+struct MockDmaChannel {
+    bool claimed;
+    dma_channel_config config;
+    volatile void *write_addr;
+    const volatile void *read_addr;
+    uint32_t count;
+    bool busy;
+    bool irq0_enabled;
+    bool irq0_status;
+    bool irq1_enabled;
+    bool irq1_status;
+    bool worker_started;
+};
+
+static const unsigned int MOCK_DMA_NUM_CHANNELS = 12;
+static MockDmaChannel dma_channels[MOCK_DMA_NUM_CHANNELS];
+// Never destroyed, since the detached worker threads are still waiting on them when the harness exits
+static std::mutex &dma_mutex = *new std::mutex;
+static MockClockCondition &dma_started = *new MockClockCondition;
+static std::map<volatile void *, mock_dma_sink_t> dma_sinks;
+
+int dma_claim_unused_channel(bool required)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    for (unsigned int channel = 0; channel < MOCK_DMA_NUM_CHANNELS; channel++) {
+        if (!dma_channels[channel].claimed) {
+            dma_channels[channel].claimed = true;
+            return channel;
+        }
+    }
+    if (required) {
+        printf("Debug: no free DMA channels\n");
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(unsigned int channel)
+{
+    return {DMA_SIZE_32, true, false, false, 0, 0x3F};
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, dma_channel_transfer_size size)
+{
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    c->read_increment = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    c->write_increment = incr;
+}
+
+void channel_config_set_ring(dma_channel_config *c, bool write, unsigned int size_bits)
+{
+    c->ring_write = write;
+    c->ring_bits = size_bits;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq)
+{
+    c->dreq = dreq;
+}
+
+// Carry out the transfers started on a channel, one after another
+static void dma_worker(unsigned int channel)
+{
+    MockDmaChannel &ch = dma_channels[channel];
+    for (;;) {
+        std::vector<uint8_t> data;
+        volatile void *write_addr;
+        size_t count;
+        unsigned int size;
+        {
+            std::unique_lock<std::mutex> lock(dma_mutex);
+            dma_started.wait(lock, [&ch] { return ch.busy; });
+
+            // Gather the source data, honouring the read ring
+            size = 1u << ch.config.size;
+            count = ch.count;
+            write_addr = ch.write_addr;
+            uintptr_t addr = (uintptr_t)ch.read_addr;
+            uintptr_t ring_mask = ch.config.ring_bits && !ch.config.ring_write ? (1u << ch.config.ring_bits) - 1 : ~(uintptr_t)0;
+            uintptr_t ring_base = addr & ~ring_mask;
+            data.resize(count * size);
+            for (size_t i = 0; i < count; i++) {
+                memcpy(&data[i * size], (const void *)addr, size);
+                if (ch.config.read_increment) {
+                    addr = ring_base | ((addr + size) & ring_mask);
+                }
+            }
+            ch.read_addr = (const volatile void *)addr;
+        }
+
+        auto sink = dma_sinks.find(write_addr);
+        if (sink != dma_sinks.end()) {
+            sink->second(write_addr, data.data(), count, size);
+        } else {
+            printf("Debug: DMA channel %u wrote %zu bytes to an unknown address\n", channel, data.size());
+        }
+
+        bool raise0, raise1;
+        {
+            std::lock_guard<std::mutex> guard(dma_mutex);
+            ch.count = 0;
+            ch.busy = false;
+            ch.irq0_status = true;
+            ch.irq1_status = true;
+            raise0 = ch.irq0_enabled;
+            raise1 = ch.irq1_enabled;
+        }
+        if (raise0) {
+            mock_irq_raise(DMA_IRQ_0);
+        }
+        if (raise1) {
+            mock_irq_raise(DMA_IRQ_1);
+        }
+    }
+}
+
+// Start the channel's current transfer. Called with dma_mutex held.
+static void dma_trigger(unsigned int channel)
+{
+    MockDmaChannel &ch = dma_channels[channel];
+    if (!ch.worker_started) {
+        ch.worker_started = true;
+        mock_clock_thread_starting();
+        std::thread(dma_worker, channel).detach();
+    }
+    ch.busy = true;
+    dma_started.notify_all();
+}
+
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    MockDmaChannel &ch = dma_channels[channel];
+    ch.config = *config;
+    ch.write_addr = write_addr;
+    ch.read_addr = read_addr;
+    ch.count = transfer_count;
+    if (trigger) {
+        dma_trigger(channel);
+    }
+}
+
+void dma_channel_set_read_addr(unsigned int channel, const volatile void *read_addr, bool trigger)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    dma_channels[channel].read_addr = read_addr;
+    if (trigger) {
+        dma_trigger(channel);
+    }
+}
+
+void dma_channel_set_trans_count(unsigned int channel, uint32_t trans_count, bool trigger)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    dma_channels[channel].count = trans_count;
+    if (trigger) {
+        dma_trigger(channel);
+    }
+}
+
+bool dma_channel_is_busy(unsigned int channel)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    return dma_channels[channel].busy;
+}
+
+void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    dma_channels[channel].irq0_enabled = enabled;
+}
+
+bool dma_channel_get_irq0_status(unsigned int channel)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    return dma_channels[channel].irq0_status;
+}
+
+void dma_channel_acknowledge_irq0(unsigned int channel)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    dma_channels[channel].irq0_status = false;
+}
+
+void dma_channel_set_irq1_enabled(unsigned int channel, bool enabled)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    dma_channels[channel].irq1_enabled = enabled;
+}
+
+bool dma_channel_get_irq1_status(unsigned int channel)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    return dma_channels[channel].irq1_status;
+}
+
+void dma_channel_acknowledge_irq1(unsigned int channel)
+{
+    std::lock_guard<std::mutex> guard(dma_mutex);
+    dma_channels[channel].irq1_status = false;
+}
+
+void mock_dma_register_sink(volatile void *addr, mock_dma_sink_t sink)
+{
+    dma_sinks[addr] = sink;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2,
+};
+
+typedef struct {
+    unsigned int size;
+    bool read_increment;
+    bool write_increment;
+    bool ring_write;
+    unsigned int ring_bits;
+    unsigned int dreq;
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(unsigned int channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_ring(dma_channel_config *c, bool write, unsigned int size_bits);
+void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq);
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger);
+void dma_channel_set_read_addr(unsigned int channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_trans_count(unsigned int channel, uint32_t trans_count, bool trigger);
+bool dma_channel_is_busy(unsigned int channel);
+void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled);
+bool dma_channel_get_irq0_status(unsigned int channel);
+void dma_channel_acknowledge_irq0(unsigned int channel);
+void dma_channel_set_irq1_enabled(unsigned int channel, bool enabled);
+bool dma_channel_get_irq1_status(unsigned int channel);
+void dma_channel_acknowledge_irq1(unsigned int channel);
+
+// Test harness hook: a peripheral register that DMA transfers can write to. The sink is called from the DMA thread
+// with each whole transfer (`count` elements of `size` bytes) and returns once the peripheral has consumed it, which
+// is how the peripheral's speed paces the transfer.
+typedef void (*mock_dma_sink_t)(volatile void *addr, const void *data, size_t count, unsigned int size);
+void mock_dma_register_sink(volatile void *addr, mock_dma_sink_t sink);
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "hardware/flash.h"
+
+uint8_t mock_flash_memory[PICO_FLASH_SIZE_BYTES];
+static std::string mock_flash_path;
+
+// Write a range of the in-memory flash back to the backing file
+static void mock_flash_persist(uint32_t flash_offs, size_t count)
+{
+    FILE *file = fopen(mock_flash_path.c_str(), "r+b");
+    if (file == nullptr) {
+        file = fopen(mock_flash_path.c_str(), "w+b");
+    }
+    if (file == nullptr) {
+        printf("Debug: could not open mock flash file %s\n", mock_flash_path.c_str());
+        return;
+    }
+    fseek(file, flash_offs, SEEK_SET);
+    fwrite(&mock_flash_memory[flash_offs], 1, count, file);
+    fclose(file);
+}
+
+void mock_flash_load(const char *path)
+{
+    mock_flash_path = path;
+    memset(mock_flash_memory, 0xFF, sizeof(mock_flash_memory));
+    FILE *file = fopen(path, "rb");
+    if (file != nullptr) {
+        size_t length = fread(mock_flash_memory, 1, sizeof(mock_flash_memory), file);
+        fclose(file);
+        printf("Debug: loaded %zu bytes of mock flash from %s\n", length, path);
+    }
+}
+
+// Load the backing file before main() runs, since the firmware reads flash directly through XIP_BASE
+static struct MockFlashLoader {
+    MockFlashLoader() {
+        const char *path = getenv("MOCK_FLASH_FILE");
+        mock_flash_load(path != nullptr ? path : "flash.bin");
+    }
+} mock_flash_loader;
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    if (flash_offs % FLASH_SECTOR_SIZE != 0 || count % FLASH_SECTOR_SIZE != 0) {
+        printf("Debug: flash erase of %zu bytes at 0x%x is not sector aligned\n", count, flash_offs);
+        return;
+    }
+    memset(&mock_flash_memory[flash_offs], 0xFF, count);
+    mock_flash_persist(flash_offs, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    if (flash_offs % FLASH_PAGE_SIZE != 0 || count % FLASH_PAGE_SIZE != 0) {
+        printf("Debug: flash program of %zu bytes at 0x%x is not page aligned\n", count, flash_offs);
+        return;
+    }
+    // NOR flash can only clear bits; programming over unerased data corrupts it just like the real part
+    for (size_t i = 0; i < count; i++) {
+        mock_flash_memory[flash_offs + i] &= data[i];
+    }
+    mock_flash_persist(flash_offs, count);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+// The mock flash is an in-memory copy of a file, standing in for the memory mapped XIP window
+extern uint8_t mock_flash_memory[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)mock_flash_memory)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+// Test harness hook: switch to a different backing file (default "flash.bin", or $MOCK_FLASH_FILE) and reload it.
+// A missing file reads as freshly erased flash.
+void mock_flash_load(const char *path);
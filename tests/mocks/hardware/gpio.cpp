@@ -1,5 +1,22 @@
 #include <iostream>
 
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "mock_clock.h"
+#include "bus_trace.h"
+
+static const unsigned int MOCK_NUM_GPIOS = 30;
+
+// Inputs idle high, as most of the sensors have pull-ups
+static bool gpio_levels[MOCK_NUM_GPIOS] = {
+    true, true, true, true, true, true, true, true, true, true, true, true, true, true, true,
+    true, true, true, true, true, true, true, true, true, true, true, true, true, true, true,
+};
+static uint32_t gpio_irq_enabled[MOCK_NUM_GPIOS];
+static uint32_t gpio_irq_pending[MOCK_NUM_GPIOS];
+static void (*gpio_raw_handlers[MOCK_NUM_GPIOS])(void);
+static gpio_irq_callback_t gpio_irq_callback = nullptr;
+
 void gpio_init(unsigned int gpio)
 {
     printf("Debug: initialised GPIO pin %u\n", gpio);
@@ -11,7 +28,80 @@ void gpio_set_dir(unsigned int gpio, bool out)
     printf("Debug: GPIO pin %u set to %s\n", gpio, out ? "output" : "input");
 }
 
+// Outputs go to the bus trace rather than the console, as a bit-banged bus would flood it
 void gpio_put(unsigned int gpio, bool val)
 {
-    printf("Debug: GPIO pin %u set to %i\n", gpio, val);
+    gpio_levels[gpio] = val;
+    mock_bus_trace_edge(gpio, val, mock_clock_now_us() * 1000);
+}
+
+bool gpio_get(unsigned int gpio)
+{
+    return gpio_levels[gpio];
+}
+
+void gpio_pull_up(unsigned int gpio)
+{
+}
+
+void gpio_set_function(unsigned int gpio, gpio_function fn)
+{
+    printf("Debug: GPIO pin %u set to function %d\n", gpio, (int)fn);
+}
+
+void gpio_set_irq_enabled(unsigned int gpio, uint32_t event_mask, bool enabled)
+{
+    if (enabled) {
+        gpio_irq_enabled[gpio] |= event_mask;
+    } else {
+        gpio_irq_enabled[gpio] &= ~event_mask;
+    }
+}
+
+void gpio_set_irq_enabled_with_callback(unsigned int gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback)
+{
+    gpio_irq_callback = callback;
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+}
+
+void gpio_add_raw_irq_handler(unsigned int gpio, void (*handler)(void))
+{
+    gpio_raw_handlers[gpio] = handler;
+}
+
+uint32_t gpio_get_irq_event_mask(unsigned int gpio)
+{
+    return gpio_irq_pending[gpio];
+}
+
+void gpio_acknowledge_irq(unsigned int gpio, uint32_t event_mask)
+{
+    gpio_irq_pending[gpio] &= ~event_mask;
+}
+
+void mock_gpio_set_input(unsigned int gpio, bool level)
+{
+    bool previous = gpio_levels[gpio];
+    gpio_levels[gpio] = level;
+    if (previous == level) {
+        return;
+    }
+    mock_bus_trace_edge(gpio, level, mock_clock_now_us() * 1000);
+
+    uint32_t events = gpio_irq_enabled[gpio] & (level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+    if (events == 0) {
+        return;
+    }
+    // Raw handlers acknowledge the event themselves; the shared callback gets it acknowledged by the SDK.
+    // Handlers run masked, like any other mocked interrupt, and wake a core waiting in WFE.
+    uint32_t irq_status = save_and_disable_interrupts();
+    gpio_irq_pending[gpio] |= events;
+    if (gpio_raw_handlers[gpio] != nullptr) {
+        gpio_raw_handlers[gpio]();
+    } else if (gpio_irq_callback != nullptr) {
+        gpio_irq_pending[gpio] &= ~events;
+        gpio_irq_callback(gpio, events);
+    }
+    restore_interrupts(irq_status);
+    mock_clock_signal();
 }
@@ -1,8 +1,38 @@
 #pragma once 
 
+#include <stdint.h>
+
 // GPIO functionality
 #define GPIO_OUT 1
 #define GPIO_IN 0
 void gpio_init(unsigned int gpio);
 void gpio_set_dir(unsigned int gpio, bool out);
 void gpio_put(unsigned int gpio, bool val);
+bool gpio_get(unsigned int gpio);
+void gpio_pull_up(unsigned int gpio);
+
+// Pin functions, matching the RP2040 numbering
+enum gpio_function {
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_PIO0 = 6,
+};
+void gpio_set_function(unsigned int gpio, gpio_function fn);
+
+// GPIO interrupts
+#define GPIO_IRQ_LEVEL_LOW 0x1u
+#define GPIO_IRQ_LEVEL_HIGH 0x2u
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+typedef void (*gpio_irq_callback_t)(unsigned int gpio, uint32_t event_mask);
+void gpio_set_irq_enabled(unsigned int gpio, uint32_t event_mask, bool enabled);
+void gpio_set_irq_enabled_with_callback(unsigned int gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback);
+void gpio_add_raw_irq_handler(unsigned int gpio, void (*handler)(void));
+uint32_t gpio_get_irq_event_mask(unsigned int gpio);
+void gpio_acknowledge_irq(unsigned int gpio, uint32_t event_mask);
+
+// Test harness hook: drive an input pin, raising any enabled edge interrupts as the real hardware would.
+void mock_gpio_set_input(unsigned int gpio, bool level);
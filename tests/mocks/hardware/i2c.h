@@ -0,0 +1,17 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// I2C instances
+typedef struct i2c_inst i2c_inst_t;
+extern i2c_inst_t *i2c0;
+extern i2c_inst_t *i2c1;
+
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+// Test harness hooks: a device at addr answers reads with the contents of the register last written to it.
+// Reads issued less than latency_us after that write are NACKed, like a sensor that is still measuring.
+void mock_i2c_set_register(uint8_t addr, uint8_t reg, const uint8_t *data, size_t len);
+void mock_i2c_set_latency(uint8_t addr, uint32_t latency_us);
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <mutex>
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "mock_clock.h"
+
+static const unsigned int MOCK_NUM_IRQS = 32;
+static irq_handler_t irq_handlers[MOCK_NUM_IRQS];
+static bool irq_enabled[MOCK_NUM_IRQS];
+static std::recursive_mutex irq_mask;
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler)
+{
+    if (irq_handlers[num] != nullptr && irq_handlers[num] != handler) {
+        printf("Debug: IRQ %u already has an exclusive handler\n", num);
+    }
+    irq_handlers[num] = handler;
+}
+
+void irq_remove_handler(unsigned int num, irq_handler_t handler)
+{
+    if (irq_handlers[num] == handler) {
+        irq_handlers[num] = nullptr;
+    }
+}
+
+void irq_set_enabled(unsigned int num, bool enabled)
+{
+    irq_enabled[num] = enabled;
+}
+
+uint32_t save_and_disable_interrupts()
+{
+    irq_mask.lock();
+    return 0;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    irq_mask.unlock();
+}
+
+void mock_irq_raise(unsigned int num)
+{
+    std::lock_guard<std::recursive_mutex> guard(irq_mask);
+    if (irq_enabled[num] && irq_handlers[num] != nullptr) {
+        irq_handlers[num]();
+        mock_clock_signal(); // Wakes a core waiting in WFE
+    }
+}
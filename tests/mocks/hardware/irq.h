@@ -0,0 +1,22 @@
+#pragma once
+
+// Interrupt numbers, matching the RP2040
+#define TIMER_IRQ_0 0
+#define PIO0_IRQ_0 7
+#define PIO0_IRQ_1 8
+#define PIO1_IRQ_0 9
+#define PIO1_IRQ_1 10
+#define DMA_IRQ_0 11
+#define DMA_IRQ_1 12
+#define IO_IRQ_BANK0 13
+#define UART0_IRQ 20
+#define UART1_IRQ 21
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler);
+void irq_remove_handler(unsigned int num, irq_handler_t handler);
+void irq_set_enabled(unsigned int num, bool enabled);
+
+// Test harness hook: run the handler for an interrupt if it is enabled, as if the hardware had raised it.
+void mock_irq_raise(unsigned int num);
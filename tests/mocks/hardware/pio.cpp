@@ -1,18 +1,152 @@
+#include <stdio.h>
+#include <string.h>
 #include <vector>
+#include <deque>
+#include <mutex>
 #include "hardware/pio.h"
+#include "hardware/irq.h"
+#include "hardware/dma.h"
+#include "mock_clock.h"
 
-PIO pio0 = 0;
-static std::vector<pio_program_t> pio_programs;
+// The RP2040 has two PIO blocks with 4 state machines each
+static const unsigned int MOCK_PIO_NUM_PIO = 2;
+static const unsigned int MOCK_PIO_NUM_SM = 4;
+
+static pio_hw_t pio_hw[MOCK_PIO_NUM_PIO];
+PIO pio0 = &pio_hw[0];
+PIO pio1 = &pio_hw[1];
+
+// Programs loaded into each block; the "offset" handed back is the index into this list
+static std::vector<pio_program_t> pio_programs[MOCK_PIO_NUM_PIO];
+static int pio_sm_program[MOCK_PIO_NUM_PIO][MOCK_PIO_NUM_SM] = {{-1, -1, -1, -1}, {-1, -1, -1, -1}};
+static unsigned int pio_next_sm[MOCK_PIO_NUM_PIO];
+
+// RX FIFOs for each state machine
+static std::deque<uint32_t> pio_rx_fifo[MOCK_PIO_NUM_PIO][MOCK_PIO_NUM_SM];
+static std::mutex pio_rx_mutex;
+static MockClockCondition pio_rx_ready;
+static bool pio_irq0_sources[MOCK_PIO_NUM_PIO][8];
+
+unsigned int pio_get_index(PIO pio)
+{
+    return pio == pio1 ? 1 : 0;
+}
+
+// DREQ_PIO0_TX0 is 0, and each block has 4 TX then 4 RX requests
+unsigned int pio_get_dreq(PIO pio, unsigned int sm, bool is_tx)
+{
+    return pio_get_index(pio) * 8 + (is_tx ? 0 : 4) + sm;
+}
+
+// DMA writes to a TX FIFO: hand each word to the program, which blocks while the FIFO would be full
+static void pio_dma_sink(volatile void *addr, const void *data, size_t count, unsigned int size)
+{
+    for (unsigned int index = 0; index < MOCK_PIO_NUM_PIO; index++) {
+        for (unsigned int sm = 0; sm < MOCK_PIO_NUM_SM; sm++) {
+            if (addr != &pio_hw[index].txf[sm]) {
+                continue;
+            }
+            for (size_t i = 0; i < count; i++) {
+                uint32_t word = 0;
+                memcpy(&word, (const uint8_t *)data + i * size, size);
+                pio_sm_put_blocking(&pio_hw[index], sm, word);
+            }
+        }
+    }
+}
 
 unsigned int pio_add_program(PIO pio, const pio_program_t* program)
 {
-    pio_programs.push_back(*program);
-    return 0;
+    static bool sinks_registered = false;
+    if (!sinks_registered) {
+        for (unsigned int index = 0; index < MOCK_PIO_NUM_PIO; index++) {
+            for (unsigned int sm = 0; sm < MOCK_PIO_NUM_SM; sm++) {
+                mock_dma_register_sink(&pio_hw[index].txf[sm], pio_dma_sink);
+            }
+        }
+        sinks_registered = true;
+    }
+
+    std::vector<pio_program_t> &programs = pio_programs[pio_get_index(pio)];
+    programs.push_back(*program);
+    return programs.size() - 1;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+    unsigned int index = pio_get_index(pio);
+    if (pio_next_sm[index] >= MOCK_PIO_NUM_SM) {
+        if (required) {
+            printf("Debug: no free state machines on pio%u\n", index);
+        }
+        return -1;
+    }
+    return pio_next_sm[index]++;
+}
+
+void mock_pio_sm_set_program(PIO pio, unsigned int sm, unsigned int offset)
+{
+    pio_sm_program[pio_get_index(pio)][sm] = offset;
 }
 
 void pio_sm_put_blocking(PIO pio, unsigned int sm, uint32_t data)
 {
-    for (auto program : pio_programs) {
-        program(data);
+    unsigned int index = pio_get_index(pio);
+    int offset = pio_sm_program[index][sm];
+    if (offset < 0) {
+        printf("Debug: pio%u state machine %u is not running a program\n", index, sm);
+        return;
+    }
+    pio_programs[index][offset](pio, sm, data);
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, unsigned int sm)
+{
+    // Programs consume their words as soon as they are written
+    return false;
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, unsigned int sm)
+{
+    std::lock_guard<std::mutex> guard(pio_rx_mutex);
+    return pio_rx_fifo[pio_get_index(pio)][sm].empty();
+}
+
+uint32_t pio_sm_get(PIO pio, unsigned int sm)
+{
+    std::lock_guard<std::mutex> guard(pio_rx_mutex);
+    if (pio_rx_fifo[pio_get_index(pio)][sm].empty()) {
+        // The real hardware returns garbage when reading an empty FIFO
+        return 0;
+    }
+    uint32_t data = pio_rx_fifo[pio_get_index(pio)][sm].front();
+    pio_rx_fifo[pio_get_index(pio)][sm].pop_front();
+    return data;
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, unsigned int sm)
+{
+    std::unique_lock<std::mutex> lock(pio_rx_mutex);
+    pio_rx_ready.wait(lock, [pio, sm] { return !pio_rx_fifo[pio_get_index(pio)][sm].empty(); });
+    uint32_t data = pio_rx_fifo[pio_get_index(pio)][sm].front();
+    pio_rx_fifo[pio_get_index(pio)][sm].pop_front();
+    return data;
+}
+
+void pio_set_irq0_source_enabled(PIO pio, pio_interrupt_source source, bool enabled)
+{
+    pio_irq0_sources[pio_get_index(pio)][source] = enabled;
+}
+
+void mock_pio_rx_push(PIO pio, unsigned int sm, uint32_t data)
+{
+    {
+        std::lock_guard<std::mutex> guard(pio_rx_mutex);
+        pio_rx_fifo[pio_get_index(pio)][sm].push_back(data);
+        pio_rx_ready.notify_all();
+    }
+
+    if (pio_irq0_sources[pio_get_index(pio)][pis_sm0_rx_fifo_not_empty + sm]) {
+        mock_irq_raise(pio == pio0 ? PIO0_IRQ_0 : PIO1_IRQ_0);
     }
 }
@@ -1,14 +1,50 @@
 #pragma once 
 
+#include <stdint.h>
 #include <vector>
 
-// Types defined just so that we can replicate the real API
-typedef uint32_t PIO;
+// Types defined just so that we can replicate the real API. Only the FIFO registers exist, so that DMA channels can be
+// pointed at them; writes to a TX FIFO by DMA are delivered to the state machine's program.
+typedef struct {
+    volatile uint32_t txf[4];
+    volatile uint32_t rxf[4];
+} pio_hw_t;
+typedef pio_hw_t *PIO;
 extern PIO pio0;
+extern PIO pio1;
 
-// A "program" in the mock is a function pointer that is called with the data being delivered to the PIO.
-typedef void (*pio_program_t)(uint32_t data);
+// A "program" in the mock is a function pointer that is called with the data being delivered to a state machine
+// running it.
+typedef void (*pio_program_t)(PIO pio, unsigned int sm, uint32_t data);
+
+// Interrupt sources, matching the RP2040 numbering
+enum pio_interrupt_source {
+    pis_sm0_rx_fifo_not_empty = 0,
+    pis_sm1_rx_fifo_not_empty,
+    pis_sm2_rx_fifo_not_empty,
+    pis_sm3_rx_fifo_not_empty,
+    pis_sm0_tx_fifo_not_full,
+    pis_sm1_tx_fifo_not_full,
+    pis_sm2_tx_fifo_not_full,
+    pis_sm3_tx_fifo_not_full,
+};
 
 // Functions defined to replicate the real API
+unsigned int pio_get_index(PIO pio);
+unsigned int pio_get_dreq(PIO pio, unsigned int sm, bool is_tx);
 unsigned int pio_add_program(PIO pio, const pio_program_t* program);
+int pio_claim_unused_sm(PIO pio, bool required);
 void pio_sm_put_blocking(PIO pio, unsigned int sm, uint32_t data);
+bool pio_sm_is_tx_fifo_full(PIO pio, unsigned int sm);
+bool pio_sm_is_rx_fifo_empty(PIO pio, unsigned int sm);
+uint32_t pio_sm_get(PIO pio, unsigned int sm);
+uint32_t pio_sm_get_blocking(PIO pio, unsigned int sm);
+void pio_set_irq0_source_enabled(PIO pio, pio_interrupt_source source, bool enabled);
+
+// Test harness hook: record that a state machine runs the program loaded at `offset`, so words written to its TX
+// FIFO are delivered to that program. The mocked *_program_init() functions call this.
+void mock_pio_sm_set_program(PIO pio, unsigned int sm, unsigned int offset);
+
+// Test harness hook: push a word into a state machine's RX FIFO, as if the PIO program had produced it.
+// Raises PIO0_IRQ_0 if the state machine's RX-not-empty source is enabled.
+void mock_pio_rx_push(PIO pio, unsigned int sm, uint32_t data);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// Interrupt handlers run on harness threads (see mock_irq_raise), so masking them takes a lock they also take
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
+
+// Waiting for an event: the harness has no interrupts to wake it, so just yield for a moment
+void __wfe();
+
+// Raise an event, waking the other core from __wfe()
+void __sev();
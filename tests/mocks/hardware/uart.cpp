@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "mock_clock.h"
+
+struct uart_inst {
+    int index;
+    std::atomic<unsigned int> bytes_per_second; // Set by the test while the DMA thread is sending
+    bool rx_irq_enabled;
+    std::deque<char> rx;
+    std::atomic<bool> capture;
+    std::vector<uint8_t> sent; // What was sent while capturing, until the test takes it
+};
+
+static uart_inst_t uart_instances[2] = {{0, 0}, {1, 0}};
+static std::mutex uart_rx_mutex;
+static std::mutex uart_sent_mutex;
+uart_inst_t *uart0 = &uart_instances[0];
+uart_inst_t *uart1 = &uart_instances[1];
+static uart_hw_t uart_hw[2];
+
+// Both UARTs write to the harness's stdout, like stdio does on the board, taking as long as the real UART would
+static void uart_send(uart_inst_t *uart, const void *data, size_t len)
+{
+    if (uart->capture) {
+        std::lock_guard<std::mutex> guard(uart_sent_mutex);
+        uart->sent.insert(uart->sent.end(), (const uint8_t *)data, (const uint8_t *)data + len);
+    } else {
+        fwrite(data, 1, len, stdout);
+        fflush(stdout);
+    }
+    unsigned int bytes_per_second = uart->bytes_per_second;
+    if (bytes_per_second) {
+        mock_clock_sleep_us(len * 1000000ull / bytes_per_second);
+    }
+}
+
+static void uart_dma_sink(volatile void *addr, const void *data, size_t count, unsigned int size)
+{
+    uart_inst_t *uart = addr == &uart_hw[0].dr ? uart0 : uart1;
+    if (size == 1) {
+        uart_send(uart, data, count);
+    } else {
+        // Wider transfers only write the low byte of each element to the data register
+        for (size_t i = 0; i < count; i++) {
+            uart_send(uart, (const uint8_t *)data + i * size, 1);
+        }
+    }
+}
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate)
+{
+    uart->bytes_per_second = baudrate / 10;
+    mock_dma_register_sink(&uart_hw[uart->index].dr, uart_dma_sink);
+    return baudrate;
+}
+
+uart_hw_t *uart_get_hw(uart_inst_t *uart)
+{
+    return &uart_hw[uart->index];
+}
+
+unsigned int uart_get_dreq(uart_inst_t *uart, bool is_tx)
+{
+    // DREQ_UART0_TX is 20 on the RP2040, followed by UART0_RX, UART1_TX and UART1_RX
+    return 20 + uart->index * 2 + (is_tx ? 0 : 1);
+}
+
+void uart_putc_raw(uart_inst_t *uart, char c)
+{
+    uart_send(uart, &c, 1);
+}
+
+void uart_puts(uart_inst_t *uart, const char *s)
+{
+    uart_send(uart, s, strlen(s));
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len)
+{
+    uart_send(uart, src, len);
+}
+
+bool uart_is_readable(uart_inst_t *uart)
+{
+    std::lock_guard<std::mutex> guard(uart_rx_mutex);
+    return !uart->rx.empty();
+}
+
+char uart_getc(uart_inst_t *uart)
+{
+    std::lock_guard<std::mutex> guard(uart_rx_mutex);
+    if (uart->rx.empty()) {
+        return 0;
+    }
+    char c = uart->rx.front();
+    uart->rx.pop_front();
+    return c;
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data)
+{
+    uart->rx_irq_enabled = rx_has_data;
+}
+
+void mock_uart_set_bandwidth(uart_inst_t *uart, unsigned int bytes_per_second)
+{
+    uart->bytes_per_second = bytes_per_second;
+}
+
+void mock_uart_capture(uart_inst_t *uart, bool enabled)
+{
+    uart->capture = enabled;
+}
+
+size_t mock_uart_take_sent(uart_inst_t *uart, uint8_t *out, size_t max)
+{
+    std::lock_guard<std::mutex> guard(uart_sent_mutex);
+    size_t count = uart->sent.size() < max ? uart->sent.size() : max;
+    memcpy(out, uart->sent.data(), count);
+    uart->sent.erase(uart->sent.begin(), uart->sent.begin() + count);
+    return count;
+}
+
+void mock_uart_rx_push(uart_inst_t *uart, const char *data, size_t len)
+{
+    {
+        std::lock_guard<std::mutex> guard(uart_rx_mutex);
+        uart->rx.insert(uart->rx.end(), data, data + len);
+    }
+    if (uart->rx_irq_enabled) {
+        mock_irq_raise(uart->index == 0 ? UART0_IRQ : UART1_IRQ);
+    }
+}
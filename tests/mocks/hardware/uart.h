@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// UART instances
+typedef struct uart_inst uart_inst_t;
+extern uart_inst_t *uart0;
+extern uart_inst_t *uart1;
+
+// Only the data register, which DMA transfers write to
+typedef struct {
+    volatile uint32_t dr;
+} uart_hw_t;
+
+unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate);
+uart_hw_t *uart_get_hw(uart_inst_t *uart);
+unsigned int uart_get_dreq(uart_inst_t *uart, bool is_tx);
+void uart_putc_raw(uart_inst_t *uart, char c);
+void uart_puts(uart_inst_t *uart, const char *s);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+bool uart_is_readable(uart_inst_t *uart);
+char uart_getc(uart_inst_t *uart);
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data);
+
+// Test harness hook: limit how fast the UART drains, in bytes per second (0 for no limit). uart_init() sets the rate
+// the baud rate would give with 8N1 framing.
+void mock_uart_set_bandwidth(uart_inst_t *uart, unsigned int bytes_per_second);
+
+// Test harness hook: keep what the UART sends for the test to read with mock_uart_take_sent(), instead of writing it
+// to stdout.
+void mock_uart_capture(uart_inst_t *uart, bool enabled);
+
+// Test harness hook: move up to `max` of the bytes captured so far into `out`, oldest first. Returns the number moved.
+size_t mock_uart_take_sent(uart_inst_t *uart, uint8_t *out, size_t max);
+
+// Test harness hook: deliver characters to the UART's receiver, raising its interrupt if RX interrupts are enabled.
+void mock_uart_rx_push(uart_inst_t *uart, const char *data, size_t len);
@@ -0,0 +1,63 @@
+#include <stdio.h>
+
+#include "hardware/pio.h"
+#include "HX711.pio.h"
+#include "bus_trace.h"
+
+// The state machine runs at 1 MHz, and the HX711 updates DOUT shortly after each rising SCK edge
+#define HX711_CYCLE_NS 1000
+#define HX711_DOUT_DELAY_NS 100
+
+void hx711_program_impl(PIO pio, unsigned int sm, uint32_t data);
+
+pio_program_t hx711_program = hx711_program_impl;
+
+// State machine that the driver loaded the program into
+static PIO mock_hx711_pio = nullptr;
+static unsigned int mock_hx711_sm = 0;
+static unsigned int mock_hx711_dout_pin = 0;
+static unsigned int mock_hx711_sck_pin = 0;
+static MockBusWriter mock_hx711_wire;
+
+void hx711_program_init(PIO pio, unsigned int sm, unsigned int offset, unsigned int dout_pin, unsigned int sck_pin)
+{
+    mock_hx711_pio = pio;
+    mock_hx711_sm = sm;
+    mock_hx711_dout_pin = dout_pin;
+    mock_hx711_sck_pin = sck_pin;
+    mock_bus_register(MOCK_BUS_HX711, sck_pin, dout_pin);
+    mock_pio_sm_set_program(pio, sm, offset);
+    printf("Debug: HX711 state machine %u on DOUT=%u, SCK=%u\n", sm, dout_pin, sck_pin);
+}
+
+void hx711_program_impl(PIO pio, unsigned int sm, uint32_t data)
+{
+    // The HX711 program never reads its TX FIFO
+}
+
+// Record the conversion being clocked out: 24 data bits, MSB first, then the 25th pulse for channel A, gain 128
+static void hx711_trace_conversion(uint32_t value)
+{
+    MockBusWriter &wire = mock_hx711_wire;
+    wire.begin();
+    wire.set(mock_hx711_dout_pin, false);
+    wire.wait(HX711_CYCLE_NS); // wait 0 pin
+    for (int bit = 23; bit >= -1; bit--) {
+        wire.set(mock_hx711_sck_pin, true);
+        wire.wait(HX711_DOUT_DELAY_NS);
+        wire.set(mock_hx711_dout_pin, bit < 0 || (value >> bit) & 1);
+        wire.wait(3 * HX711_CYCLE_NS - HX711_DOUT_DELAY_NS);
+        wire.set(mock_hx711_sck_pin, false);
+        wire.wait(2 * HX711_CYCLE_NS);
+    }
+}
+
+void mock_hx711_push_sample(int32_t value)
+{
+    if (mock_bus_trace_enabled()) {
+        hx711_trace_conversion((uint32_t)value & 0xFFFFFF);
+    }
+
+    // The state machine autopushes 24 bits, so the upper byte is always clear
+    mock_pio_rx_push(mock_hx711_pio, mock_hx711_sm, (uint32_t)value & 0xFFFFFF);
+}
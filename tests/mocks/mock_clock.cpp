@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "mock_clock.h"
+
+// Run when the simulation ends
+static std::vector<void (*)(uint64_t)> clock_exit_handlers;
+
+#if MOCK_VIRTUAL_TIME
+
+// Threads waiting for a time, in the order they are due. Equal deadlines wake in the order they started waiting.
+struct MockSleeper {
+    bool event;  // Also woken by mock_clock_signal()
+    bool woken;
+    bool signalled;
+};
+
+static std::mutex clock_mutex;
+static std::condition_variable clock_changed;
+static uint64_t clock_now_us = 0;
+static uint64_t clock_limit_us = UINT64_MAX;
+static int clock_running = 1; // The main thread
+static bool clock_event = false;
+static std::multimap<uint64_t, MockSleeper *> clock_sleepers;
+
+static void clock_read_limit() {
+    static bool done = false;
+    if (!done) {
+        const char *limit = getenv("MOCK_TIME_LIMIT_S");
+        if (limit != nullptr) {
+            clock_limit_us = (uint64_t)(strtod(limit, nullptr) * 1e6);
+        }
+        done = true;
+    }
+}
+
+// End the simulation. Called with clock_mutex held and every other thread waiting, so the handlers have the mocks to
+// themselves.
+static void clock_exit(const char *reason) {
+    fflush(stdout);
+    fprintf(stderr, "Debug: simulation %s at %.6f s\n", reason, clock_now_us / 1e6);
+    for (auto handler : clock_exit_handlers) {
+        handler(clock_now_us);
+    }
+    fflush(stderr);
+    _Exit(0);
+}
+
+// With every thread waiting, jump to the next wake-up. Called with clock_mutex held.
+static void clock_advance() {
+    if (clock_running > 0) {
+        return;
+    }
+    if (clock_sleepers.empty() || clock_sleepers.begin()->first == UINT64_MAX) {
+        clock_exit("ended, no thread can wake again,");
+    }
+    auto next = clock_sleepers.begin();
+    if (next->first > clock_limit_us) {
+        clock_now_us = clock_limit_us;
+        clock_exit("reached MOCK_TIME_LIMIT_S");
+    }
+    if (next->first > clock_now_us) {
+        clock_now_us = next->first;
+    }
+    next->second->woken = true;
+    clock_sleepers.erase(next);
+    clock_running++;
+    clock_changed.notify_all();
+}
+
+uint64_t mock_clock_now_us() {
+    std::lock_guard<std::mutex> guard(clock_mutex);
+    return clock_now_us;
+}
+
+// Wait until the deadline, or an event if `event` is set. Returns true if woken by an event.
+static bool clock_wait(uint64_t deadline_us, bool event) {
+    std::unique_lock<std::mutex> lock(clock_mutex);
+    clock_read_limit();
+    if (event && clock_event) {
+        clock_event = false;
+        return true;
+    }
+    if (deadline_us <= clock_now_us) {
+        return false;
+    }
+    MockSleeper sleeper = {event, false, false};
+    clock_sleepers.emplace(deadline_us, &sleeper);
+    clock_running--;
+    clock_advance();
+    clock_changed.wait(lock, [&sleeper] { return sleeper.woken; });
+    if (sleeper.signalled) {
+        clock_event = false;
+    }
+    return sleeper.signalled;
+}
+
+void mock_clock_sleep_until(uint64_t deadline_us) {
+    clock_wait(deadline_us, false);
+}
+
+bool mock_clock_wait_event_until(uint64_t deadline_us) {
+    return clock_wait(deadline_us, true);
+}
+
+void mock_clock_signal() {
+    std::lock_guard<std::mutex> guard(clock_mutex);
+    clock_event = true;
+    for (auto it = clock_sleepers.begin(); it != clock_sleepers.end();) {
+        if (it->second->event) {
+            it->second->woken = true;
+            it->second->signalled = true;
+            clock_running++;
+            it = clock_sleepers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    clock_changed.notify_all();
+}
+
+void mock_clock_thread_starting() {
+    mock_clock_thread_busy();
+}
+
+void mock_clock_thread_exiting() {
+    mock_clock_thread_idle();
+}
+
+void mock_clock_thread_idle() {
+    std::lock_guard<std::mutex> guard(clock_mutex);
+    clock_running--;
+    clock_advance();
+}
+
+void mock_clock_thread_busy() {
+    std::lock_guard<std::mutex> guard(clock_mutex);
+    clock_running++;
+}
+
+void mock_clock_on_exit(void (*handler)(uint64_t end_us)) {
+    std::lock_guard<std::mutex> guard(clock_mutex);
+    clock_exit_handlers.push_back(handler);
+}
+
+#else
+
+// Real time: waits are real waits, and only the event flag needs any bookkeeping
+static std::mutex clock_mutex;
+static std::condition_variable clock_changed;
+static bool clock_event = false;
+static const std::chrono::steady_clock::time_point clock_start = std::chrono::steady_clock::now();
+
+uint64_t mock_clock_now_us() {
+    auto elapsed = std::chrono::steady_clock::now() - clock_start;
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void mock_clock_sleep_until(uint64_t deadline_us) {
+    std::this_thread::sleep_until(clock_start + std::chrono::microseconds(deadline_us));
+}
+
+bool mock_clock_wait_event_until(uint64_t deadline_us) {
+    std::unique_lock<std::mutex> lock(clock_mutex);
+    bool signalled = true;
+    if (deadline_us == UINT64_MAX) {
+        clock_changed.wait(lock, [] { return clock_event; });
+    } else {
+        auto deadline = clock_start + std::chrono::microseconds(deadline_us);
+        signalled = clock_changed.wait_until(lock, deadline, [] { return clock_event; });
+    }
+    clock_event = false;
+    return signalled;
+}
+
+void mock_clock_signal() {
+    std::lock_guard<std::mutex> guard(clock_mutex);
+    clock_event = true;
+    clock_changed.notify_all();
+}
+
+void mock_clock_thread_starting() {
+}
+
+void mock_clock_thread_exiting() {
+}
+
+void mock_clock_thread_idle() {
+}
+
+void mock_clock_thread_busy() {
+}
+
+// Real-time runs only end when the process exits normally
+static void clock_exit() {
+    for (auto handler : clock_exit_handlers) {
+        handler(mock_clock_now_us());
+    }
+}
+
+void mock_clock_on_exit(void (*handler)(uint64_t end_us)) {
+    std::lock_guard<std::mutex> guard(clock_mutex);
+    if (clock_exit_handlers.empty()) {
+        atexit(clock_exit);
+    }
+    clock_exit_handlers.push_back(handler);
+}
+
+#endif
+
+void mock_clock_sleep_us(uint64_t us) {
+    mock_clock_sleep_until(mock_clock_now_us() + us);
+}
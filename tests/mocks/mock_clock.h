@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+#include <condition_variable>
+
+// Time source for the harness. Every mock that reads the time or waits goes through here.
+//
+// By default this is the host's steady clock, so the firmware runs in real time. Building with MOCK_VIRTUAL_TIME
+// switches to a discrete-event clock instead: time stands still while any harness thread is running, and when every
+// thread is waiting it jumps straight to the earliest wake-up. Sleeps cost nothing, timers and interrupts happen in
+// deadline order, and runs are repeatable. When no thread can ever wake again the simulation has ended, and the
+// harness exits. Setting MOCK_TIME_LIMIT_S in the environment also ends it after that much simulated time.
+//
+// In virtual time the clock has to know which threads are busy. The main thread counts from the start; any other
+// thread that runs firmware or mock hardware must be started with mock_clock_thread_starting(), and must wait for
+// other threads with MockClockCondition rather than a bare condition variable.
+
+/// Microseconds since the harness started.
+uint64_t mock_clock_now_us();
+
+/// Block the calling thread until the clock reaches `deadline_us`.
+void mock_clock_sleep_until(uint64_t deadline_us);
+
+void mock_clock_sleep_us(uint64_t us);
+
+/// Wait for an event, like WFE: returns true if mock_clock_signal() was called since the last wait (or during it),
+/// false once `deadline_us` passes.
+bool mock_clock_wait_event_until(uint64_t deadline_us);
+
+/// Raise an event, like SEV. Called when an interrupt handler runs or a core writes to the inter-core FIFO.
+void mock_clock_signal();
+
+/// Call before starting a harness thread, from the thread that starts it, so time can't move before it runs.
+void mock_clock_thread_starting();
+
+/// Call as a harness thread finishes.
+void mock_clock_thread_exiting();
+
+/// Call `handler` with the final time when the simulation ends, e.g. to print a report. In virtual time it runs with
+/// the clock locked, so it must not read the clock or wait.
+void mock_clock_on_exit(void (*handler)(uint64_t end_us));
+
+// Called by MockClockCondition: the calling thread is about to wait on another thread, or has been woken from that
+// wait without anyone accounting for it.
+void mock_clock_thread_idle();
+void mock_clock_thread_busy();
+
+/// A condition variable whose waiters don't hold virtual time back. Notify with the mutex held, so the clock learns
+/// that the waiters are runnable before the notifying thread can go to sleep.
+class MockClockCondition {
+public:
+    template <typename Predicate>
+    void wait(std::unique_lock<std::mutex> &lock, Predicate ready) {
+        while (!ready()) {
+            waiting++;
+            mock_clock_thread_idle();
+            cv.wait(lock);
+            waiting--;
+            if (woken > 0) {
+                woken--; // notify_all() already counted this thread as running
+            } else {
+                mock_clock_thread_busy();
+            }
+        }
+    }
+
+    void notify_all() {
+        for (; woken < waiting; woken++) {
+            mock_clock_thread_busy();
+        }
+        cv.notify_all();
+    }
+
+private:
+    std::condition_variable cv;
+    int waiting = 0; // Threads blocked in wait()
+    int woken = 0;   // Of those, the ones notify_all() has already counted as running
+};
@@ -0,0 +1,4 @@
+#pragma once
+
+// Binary info only describes the firmware image to picotool, so the harness drops it
+#define bi_decl(...)
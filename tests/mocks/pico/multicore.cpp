@@ -0,0 +1,123 @@
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "pico/multicore.h"
+#include "mock_clock.h"
+
+// The hardware FIFOs are 8 words deep in each direction
+static const size_t MOCK_FIFO_DEPTH = 8;
+static std::deque<uint32_t> mock_fifo[NUM_CORES]; // mock_fifo[n] is read by core n
+static std::mutex mock_fifo_mutex;
+static MockClockCondition mock_fifo_changed;
+static bool mock_lockout_victim[NUM_CORES];
+static bool mock_lockout_held[NUM_CORES]; // The victim is parked in its lockout handler
+
+// Handshake words used by the SDK's multicore lockout
+static const uint32_t MOCK_LOCKOUT_MAGIC_START = 0x73a8831e;
+static const uint32_t MOCK_LOCKOUT_MAGIC_END = 0x73a8831f;
+
+static thread_local unsigned int mock_core_num = 0;
+
+unsigned int get_core_num()
+{
+    return mock_core_num;
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    mock_clock_thread_starting();
+    std::thread core1([entry] {
+        mock_core_num = 1;
+        entry();
+        mock_clock_thread_exiting();
+    });
+    core1.detach();
+}
+
+bool multicore_fifo_rvalid()
+{
+    std::lock_guard<std::mutex> guard(mock_fifo_mutex);
+    return !mock_fifo[get_core_num()].empty();
+}
+
+bool multicore_fifo_wready()
+{
+    std::lock_guard<std::mutex> guard(mock_fifo_mutex);
+    return mock_fifo[get_core_num() ^ 1].size() < MOCK_FIFO_DEPTH;
+}
+
+// A lockout victim has the SDK's FIFO interrupt handler installed, which reads every word as soon as it arrives. It
+// answers the lockout handshake and throws anything else away, so firmware sharing the FIFO with the lockout loses its
+// messages here just as it would on the board. The handler runs straight away instead of on the victim's thread; its
+// replies are allowed past the FIFO depth, since the core waiting for them is the one pushing.
+static void mock_lockout_handler(unsigned int victim, uint32_t data)
+{
+    std::deque<uint32_t> &reply = mock_fifo[victim ^ 1];
+    if (data == MOCK_LOCKOUT_MAGIC_START && !mock_lockout_held[victim]) {
+        mock_lockout_held[victim] = true;
+        reply.push_back(MOCK_LOCKOUT_MAGIC_START);
+    } else if (data == MOCK_LOCKOUT_MAGIC_END && mock_lockout_held[victim]) {
+        mock_lockout_held[victim] = false;
+        reply.push_back(MOCK_LOCKOUT_MAGIC_END);
+    }
+}
+
+void multicore_fifo_push_blocking(uint32_t data)
+{
+    std::unique_lock<std::mutex> lock(mock_fifo_mutex);
+    unsigned int target = get_core_num() ^ 1;
+    std::deque<uint32_t> &fifo = mock_fifo[target];
+    mock_fifo_changed.wait(lock, [&fifo] { return fifo.size() < MOCK_FIFO_DEPTH; });
+    if (mock_lockout_victim[target]) {
+        mock_lockout_handler(target, data);
+    } else {
+        fifo.push_back(data);
+    }
+    mock_fifo_changed.notify_all();
+    mock_clock_signal(); // The SDK follows a push with SEV
+}
+
+uint32_t multicore_fifo_pop_blocking()
+{
+    std::unique_lock<std::mutex> lock(mock_fifo_mutex);
+    std::deque<uint32_t> &fifo = mock_fifo[get_core_num()];
+    mock_fifo_changed.wait(lock, [&fifo] { return !fifo.empty(); });
+    uint32_t data = fifo.front();
+    fifo.pop_front();
+    mock_fifo_changed.notify_all();
+    return data;
+}
+
+void multicore_lockout_victim_init()
+{
+    std::lock_guard<std::mutex> guard(mock_fifo_mutex);
+    unsigned int core = get_core_num();
+    mock_lockout_victim[core] = true;
+    // Installing the handler drains whatever was already waiting
+    mock_fifo[core].clear();
+    mock_fifo_changed.notify_all();
+}
+
+bool multicore_lockout_victim_is_initialized(unsigned int core_num)
+{
+    return mock_lockout_victim[core_num];
+}
+
+// Like the SDK: send the magic word and read replies until it comes back, discarding anything else in this core's FIFO
+static void mock_lockout_handshake(uint32_t magic)
+{
+    do {
+        multicore_fifo_push_blocking(magic);
+    } while (multicore_fifo_pop_blocking() != magic);
+}
+
+void multicore_lockout_start_blocking()
+{
+    mock_lockout_handshake(MOCK_LOCKOUT_MAGIC_START);
+}
+
+void multicore_lockout_end_blocking()
+{
+    mock_lockout_handshake(MOCK_LOCKOUT_MAGIC_END);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include "pico/platform.h"
+
+// Core 1 runs on its own std::thread in the harness
+void multicore_launch_core1(void (*entry)(void));
+
+// Inter-core FIFOs: each core reads what the other one pushed
+bool multicore_fifo_rvalid();
+bool multicore_fifo_wready();
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking();
+
+// Flash write lockout of the other core. Nothing executes from flash in the harness, so the victim is not really paused,
+// but the handshake uses the FIFOs as the SDK's does: a victim's FIFO is drained by its lockout handler.
+void multicore_lockout_victim_init();
+bool multicore_lockout_victim_is_initialized(unsigned int core_num);
+void multicore_lockout_start_blocking();
+void multicore_lockout_end_blocking();
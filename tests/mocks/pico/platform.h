@@ -0,0 +1,6 @@
+#pragma once
+
+#define NUM_CORES 2
+
+// Index of the calling core. In the harness, core 1 is the thread started by multicore_launch_core1().
+unsigned int get_core_num();
@@ -0,0 +1,15 @@
+#pragma once
+
+typedef struct stdio_driver stdio_driver_t;
+
+struct stdio_driver {
+    void (*out_chars)(const char *buf, int len);
+    void (*out_flush)(void);
+    int (*in_chars)(char *buf, int len);
+    stdio_driver_t *next;
+    bool last_ended_with_cr;
+    bool crlf_enabled;
+};
+
+// The harness's printf always goes to stdout; this only records which drivers are enabled
+void stdio_set_driver_enabled(stdio_driver_t *driver, bool enabled);
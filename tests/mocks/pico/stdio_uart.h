@@ -0,0 +1,4 @@
+#pragma once
+#include "pico/stdio.h"
+
+extern stdio_driver_t stdio_uart;
@@ -1,21 +1,47 @@
 #include <iostream>
-#include <thread>
-#include <chrono>
 
 #include "pico/stdlib.h"
-#include "ws2812.pio.h"
+#include "pico/stdio.h"
+#include "pico/stdio_uart.h"
+#include "WS2812.pio.h"
+#include "mock_clock.h"
+#include "stimulus.h"
 
+stdio_driver_t stdio_uart;
+static stdio_driver_t *stdio_drivers = &stdio_uart;
+
+// The first call the firmware makes, so the harness starts its input here
 void stdio_init_all()
 {
+    mock_stimulus_start();
+}
 
+void stdio_set_driver_enabled(stdio_driver_t *driver, bool enabled)
+{
+    stdio_driver_t **link = &stdio_drivers;
+    while (*link != nullptr && *link != driver) {
+        link = &(*link)->next;
+    }
+    if (enabled && *link == nullptr) {
+        driver->next = nullptr;
+        *link = driver;
+    } else if (!enabled && *link != nullptr) {
+        *link = driver->next;
+    }
 }
 
 void sleep_ms(uint32_t ms)
 {
-    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    mock_clock_sleep_us((uint64_t)ms * 1000);
 }
 
 void sleep_us(uint32_t us)
 {
-    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    mock_clock_sleep_us(us);
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    // The harness has no console input, so no key ever arrives
+    return PICO_ERROR_TIMEOUT;
 }
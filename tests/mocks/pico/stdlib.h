@@ -1,8 +1,16 @@
 #pragma once
 #include <stdint.h>
+#include "pico/time.h"
+#include "hardware/uart.h"
 
 // Generic API
 typedef unsigned int uint;
 void stdio_init_all();
 void sleep_ms(uint32_t ms);
 void sleep_us(uint32_t us);
+
+// Standard IO
+#define PICO_ERROR_TIMEOUT -1
+#define PICO_ERROR_GENERIC -2
+#define PICO_ERROR_NO_DATA -3
+int getchar_timeout_us(uint32_t timeout_us);
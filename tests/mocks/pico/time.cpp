@@ -1,8 +1,11 @@
 #include "pico/time.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+#include "mock_clock.h"
 
 absolute_time_t get_absolute_time() 
 {   
-    return std::chrono::steady_clock::now();
+    return from_us_since_boot(mock_clock_now_us());
 }
 
 uint32_t to_ms_since_boot(absolute_time_t t)
@@ -11,3 +14,35 @@ uint32_t to_ms_since_boot(absolute_time_t t)
     auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
     return (uint32_t)millis;
 }
+
+absolute_time_t from_us_since_boot(uint64_t us)
+{
+    return absolute_time_t(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::microseconds(us)));
+}
+
+uint64_t time_us_64()
+{
+    return mock_clock_now_us();
+}
+
+// Mocked interrupts and the inter-core FIFO raise events, so these wake early just like on the board
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+    auto timeout_us = std::chrono::duration_cast<std::chrono::microseconds>(timeout_timestamp.time_since_epoch());
+    return !mock_clock_wait_event_until((uint64_t)timeout_us.count());
+}
+
+void __wfe()
+{
+#if MOCK_VIRTUAL_TIME
+    mock_clock_wait_event_until(UINT64_MAX);
+#else
+    // Not every input the tests change raises an event, so don't wait long in real time
+    mock_clock_wait_event_until(mock_clock_now_us() + 1000);
+#endif
+}
+
+void __sev()
+{
+    mock_clock_signal();
+}
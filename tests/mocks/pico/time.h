@@ -7,3 +7,5 @@ typedef std::chrono::time_point<std::chrono::steady_clock,std::chrono::steady_cl
 
 uint32_t to_ms_since_boot(absolute_time_t t);
 absolute_time_t get_absolute_time();
+absolute_time_t from_us_since_boot(uint64_t us);
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
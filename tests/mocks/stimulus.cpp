@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/uart.h"
+#include "HX711.pio.h"
+#include "mock_clock.h"
+#include "stimulus.h"
+
+// The ultrasonic sensor (see ultrasonic.cpp) returns the distance big-endian from this register
+#define STIM_ULTRASONIC_ADDR 0x35
+#define STIM_ULTRASONIC_REG 0x05
+
+enum StimTarget {
+    STIM_GPIO,
+    STIM_HX711,
+    STIM_I2C,
+    STIM_UART,
+};
+
+struct StimEvent {
+    uint64_t time_us;
+    StimTarget target;
+    long a;                     // Pin, counts or I2C address
+    long b;                     // Level or I2C register
+    std::vector<uint8_t> bytes; // I2C register contents
+    std::string text;           // UART line
+};
+
+static std::vector<StimEvent> stim_events;
+
+// Split off the next comma-separated field, or return nullptr if there are none left
+static char *stim_field(char **rest) {
+    if (*rest == nullptr) {
+        return nullptr;
+    }
+    char *field = *rest;
+    char *comma = strchr(field, ',');
+    if (comma != nullptr) {
+        *comma = '\0';
+        *rest = comma + 1;
+    } else {
+        *rest = nullptr;
+    }
+    return field;
+}
+
+// Parse one trace line. Returns false if it is malformed.
+static bool stim_parse(char *line, StimEvent *event) {
+    char *rest = line;
+    char *time = stim_field(&rest);
+    char *target = stim_field(&rest);
+    if (time == nullptr || target == nullptr) {
+        return false;
+    }
+    event->time_us = (uint64_t)(strtod(time, nullptr) * 1e6);
+
+    if (strcmp(target, "uart") == 0) {
+        event->target = STIM_UART;
+        event->text = rest != nullptr ? rest : "";
+        event->text += '\n';
+        return true;
+    }
+
+    std::vector<char *> args;
+    for (char *arg; (arg = stim_field(&rest)) != nullptr;) {
+        args.push_back(arg);
+    }
+    if (strcmp(target, "gpio") == 0 && args.size() == 2) {
+        event->target = STIM_GPIO;
+        event->a = strtol(args[0], nullptr, 0);
+        event->b = strtol(args[1], nullptr, 0);
+        return event->a >= 0 && event->a < 30;
+    }
+    if (strcmp(target, "hx711") == 0 && args.size() == 1) {
+        event->target = STIM_HX711;
+        event->a = strtol(args[0], nullptr, 0);
+        return true;
+    }
+    if (strcmp(target, "distance") == 0 && args.size() == 1) {
+        long mm = strtol(args[0], nullptr, 0);
+        event->target = STIM_I2C;
+        event->a = STIM_ULTRASONIC_ADDR;
+        event->b = STIM_ULTRASONIC_REG;
+        event->bytes = {(uint8_t)(mm >> 8), (uint8_t)mm};
+        return true;
+    }
+    if (strcmp(target, "i2c") == 0 && args.size() == 3) {
+        event->target = STIM_I2C;
+        event->a = strtol(args[0], nullptr, 0);
+        event->b = strtol(args[1], nullptr, 0);
+        const char *hex = args[2];
+        if (strlen(hex) % 2 != 0) {
+            return false;
+        }
+        for (size_t i = 0; hex[i] != '\0'; i += 2) {
+            char byte[3] = {hex[i], hex[i + 1], '\0'};
+            event->bytes.push_back((uint8_t)strtoul(byte, nullptr, 16));
+        }
+        return event->a >= 0 && event->a < 128 && event->b >= 0 && event->b < 256;
+    }
+    return false;
+}
+
+static void stim_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        printf("Debug: can't open stimulus trace %s\n", path);
+        return;
+    }
+    char line[256];
+    for (int number = 1; fgets(line, sizeof(line), file) != nullptr; number++) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        StimEvent event = {};
+        if (!stim_parse(line, &event)) {
+            printf("Debug: %s:%d: can't parse stimulus line\n", path, number);
+            continue;
+        }
+        stim_events.push_back(event);
+    }
+    fclose(file);
+}
+
+static void stim_apply(const StimEvent &event) {
+    switch (event.target) {
+        case STIM_GPIO:
+            mock_gpio_set_input(event.a, event.b != 0);
+            break;
+        case STIM_HX711:
+            mock_hx711_push_sample((int32_t)event.a);
+            break;
+        case STIM_I2C:
+            mock_i2c_set_register(event.a, event.b, event.bytes.data(), event.bytes.size());
+            break;
+        case STIM_UART:
+            mock_uart_rx_push(uart0, event.text.data(), event.text.size());
+            break;
+    }
+}
+
+static void stim_thread() {
+    for (const StimEvent &event : stim_events) {
+        mock_clock_sleep_until(event.time_us);
+        stim_apply(event);
+    }
+    printf("Debug: stimulus traces finished\n");
+    mock_clock_thread_exiting();
+}
+
+void mock_stimulus_start() {
+    const char *paths = getenv("STIM_TRACE");
+    if (paths == nullptr || stim_events.size() > 0) {
+        return;
+    }
+    std::string list = paths;
+    for (size_t start = 0; start <= list.size();) {
+        size_t end = list.find(':', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        if (end > start) {
+            stim_load(list.substr(start, end - start).c_str());
+        }
+        start = end + 1;
+    }
+
+    // Merge the traces, keeping each one's order for events at the same time
+    std::stable_sort(stim_events.begin(), stim_events.end(),
+                     [](const StimEvent &x, const StimEvent &y) { return x.time_us < y.time_us; });
+    printf("Debug: replaying %zu stimulus events\n", stim_events.size());
+    mock_clock_thread_starting();
+    std::thread(stim_thread).detach();
+}
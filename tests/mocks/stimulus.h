@@ -0,0 +1,17 @@
+#pragma once
+
+// Scripted sensor input for the harness.
+//
+// STIM_TRACE names one or more CSV traces (separated by ':'), which are merged by time and replayed on their own
+// thread into the mocked inputs, so the real drivers see a recorded or made-up session. Each line is
+//     time_s,target,arguments...
+// with time in seconds since the harness started. Blank lines and lines starting with '#' are skipped. Targets:
+//     gpio,<pin>,<0|1>               drive an input pin (e.g. the IR beam on pin 4 goes low while a car passes)
+//     hx711,<counts>                 deliver a raw HX711 conversion
+//     distance,<mm>                  set the reading of the ultrasonic sensor
+//     i2c,<addr>,<reg>,<hex bytes>   set an I2C device register, e.g. i2c,0x35,0x05,0352
+//     uart,<text>                    receive a console line (the rest of the line, commas included)
+// Traces run in real time, or instantly with MOCK_VIRTUAL_TIME.
+
+/// Test harness hook: start replaying the traces named by STIM_TRACE, if it is set. Called by stdio_init_all().
+void mock_stimulus_start();
@@ -0,0 +1,115 @@
+#include <stdio.h>
+
+#include "hardware/pio.h"
+#include "TM1637.pio.h"
+#include "bus_trace.h"
+
+// The state machine runs at 1 MHz
+#define TM1637_CYCLE_NS 1000
+
+void tm1637_program_impl(PIO pio, unsigned int sm, uint32_t data);
+
+pio_program_t tm1637_program = tm1637_program_impl;
+
+// Decoder state for each display, indexed like the state machines that drive them
+struct MockTm1637 {
+    unsigned int dio_pin;
+    unsigned int clk_pin;
+    int address;      // Next digit to be written, or -1 outside a data transfer
+    bool in_transfer; // Between a start and a stop condition
+    bool fixed;       // Fixed address mode: each transfer writes one digit
+    uint8_t digits[4];
+    MockBusWriter wire;
+};
+
+static MockTm1637 mock_tm1637[2][4];
+
+void tm1637_program_init(PIO pio, unsigned int sm, unsigned int offset, unsigned int dio_pin, unsigned int clk_pin)
+{
+    mock_pio_sm_set_program(pio, sm, offset);
+    mock_tm1637[pio_get_index(pio)][sm] = {dio_pin, clk_pin, -1, false, false, {0, 0, 0, 0}, {}};
+    mock_bus_register(MOCK_BUS_TM1637, clk_pin, dio_pin);
+    printf("Debug: TM1637 state machine %u on DIO=%u, CLK=%u\n", sm, dio_pin, clk_pin);
+}
+
+// Record the waveform tm1637_program puts on the bus for one FIFO word, instruction by instruction. The display
+// pulls DIO low to acknowledge each byte, and releases it when the ACK clock falls.
+static void tm1637_trace_word(MockTm1637 &display, uint32_t word)
+{
+    MockBusWriter &wire = display.wire;
+    unsigned int clk = display.clk_pin;
+    unsigned int dio = display.dio_pin;
+    wire.begin();
+
+    wire.wait(3 * TM1637_CYCLE_NS); // pull, out, jmp
+    if (word & 1) {
+        wire.set(dio, false);
+        wire.wait(3 * TM1637_CYCLE_NS);
+        wire.set(clk, false);
+        wire.wait(3 * TM1637_CYCLE_NS);
+    }
+    wire.wait(TM1637_CYCLE_NS); // set y
+    for (unsigned int bit = 0; bit < 8; bit++) {
+        wire.set(clk, false);
+        wire.set(dio, !(word & (2u << bit)));
+        wire.wait(3 * TM1637_CYCLE_NS);
+        wire.set(clk, true);
+        wire.wait(3 * TM1637_CYCLE_NS);
+    }
+    wire.set(clk, false);
+    wire.set(dio, false); // ACK
+    wire.wait(3 * TM1637_CYCLE_NS);
+    wire.set(clk, true);
+    wire.wait(3 * TM1637_CYCLE_NS);
+    wire.set(clk, false);
+    wire.set(dio, true);
+    wire.wait(4 * TM1637_CYCLE_NS); // out, jmp
+    if (word & (1u << 9)) {
+        wire.set(dio, false);
+        wire.wait(3 * TM1637_CYCLE_NS);
+        wire.set(clk, true);
+        wire.wait(3 * TM1637_CYCLE_NS);
+        wire.set(dio, true);
+        wire.wait(3 * TM1637_CYCLE_NS);
+    }
+}
+
+// Decode the bus traffic the state machine would produce and print the digits whenever a transfer updates them
+void tm1637_program_impl(PIO pio, unsigned int sm, uint32_t word)
+{
+    MockTm1637 &display = mock_tm1637[pio_get_index(pio)][sm];
+    if (mock_bus_trace_enabled()) {
+        tm1637_trace_word(display, word);
+    }
+
+    bool start = word & 1;
+    uint8_t data = (uint8_t)~(word >> 1);
+    bool stop = word & (1u << 9);
+
+    if (start) {
+        display.in_transfer = true;
+        // The first byte after a start is a command
+        if ((data & 0xC0) == 0xC0) {
+            display.address = data & 0x03;
+        } else {
+            if ((data & 0xC0) == 0x40) {
+                display.fixed = data & 0x04;
+            }
+            display.address = -1;
+        }
+    } else if (display.in_transfer && display.address >= 0 && display.address < 4) {
+        display.digits[display.address] = data;
+        if (!display.fixed) {
+            display.address++;
+        }
+    }
+
+    if (stop && display.in_transfer && !start) {
+        printf("Debug: TM1637 DIO=%u segments = %02X %02X %02X %02X\n", display.dio_pin,
+               display.digits[0], display.digits[1], display.digits[2], display.digits[3]);
+    }
+    if (stop) {
+        display.in_transfer = false;
+        display.address = -1;
+    }
+}
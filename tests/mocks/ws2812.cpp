@@ -1,77 +1,237 @@
-#include <vector>
-#include <iostream>
-#include <chrono>
+// Words written to the state machine are appended to a capture log without taking any locks, and frames are cut where
+// the strip would latch: when the line has idled for 280 us after the last bit. The wire time of each word is worked
+// out from the program's bit timing, so latching follows the mock clock without a thread watching the bus. Only one
+// thread may write to the state machine at a time, as on the real hardware; any thread may query the captured frames.
+// Writers are held back while the TX FIFO would be full, so a DMA channel feeding the FIFO finishes when the real one
+// would.
+
+#include <stdio.h>
+#include <algorithm>
 #include <atomic>
-#include <mutex>
-#include <thread>
-#include <semaphore>
 
 #include "hardware/pio.h"
-#include "ws2812.pio.h"
+#include "WS2812.pio.h"
+#include "mock_clock.h"
+#include "bus_trace.h"
 
-void ws2812_program_impl(uint32_t data);
-void ws2812_idle_detection_thread();
+void ws2812_program_impl(PIO pio, unsigned int sm, uint32_t data);
 
 pio_program_t ws2812_program = ws2812_program_impl;
 
-// Array in which to receive the LED data during each call to pio_sm_put_blocking
-std::vector<uint32_t> mock_ws2812_leds;
-std::mutex mock_ws2812_leds_mutex;
-std::binary_semaphore mock_ws2812_semaphore (0); // to signal that the idle detection thread should wake up
+// Frames with more LEDs than this are abbreviated on the console
+#define WS2812_PRINT_LEDS 16
+
+// Words the joined TX FIFO holds before a writer (the CPU or a DMA channel) has to wait
+#define WS2812_FIFO_DEPTH 8
+
+// Append-only storage for one writer and any number of readers, without locks. Elements live in fixed-size chunks that
+// never move, and readers may look at any element below the published size.
+template <typename T, size_t CHUNK, size_t MAX_CHUNKS>
+class MockAppendLog {
+public:
+    // Returns false once the log is full
+    bool push(const T &value) {
+        size_t n = count.load(std::memory_order_relaxed);
+        if (n >= CHUNK * MAX_CHUNKS) {
+            return false;
+        }
+        if (chunks[n / CHUNK] == nullptr) {
+            chunks[n / CHUNK] = new T[CHUNK];
+        }
+        chunks[n / CHUNK][n % CHUNK] = value;
+        count.store(n + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return count.load(std::memory_order_acquire);
+    }
+
+    const T &operator[](size_t index) const {
+        return chunks[index / CHUNK][index % CHUNK];
+    }
+
+private:
+    T *chunks[MAX_CHUNKS] = {};
+    std::atomic<size_t> count{0};
+};
+
+struct Ws2812FrameRecord {
+    size_t first; // Index of the first word in the word log
+    size_t leds;
+    uint64_t latch_us;
+};
+
+// Up to 16M words (64 MB) and 1M frames are captured
+static MockAppendLog<uint32_t, 4096, 4096> ws2812_words;
+static MockAppendLog<Ws2812FrameRecord, 1024, 1024> ws2812_frames;
+
+// The frame still being sent, which latches at `latch_ns` unless another word arrives first. Readers take a consistent
+// copy of it and the number of finished frames by retrying while `seq` is odd or changes under them.
+static std::atomic<uint32_t> ws2812_seq{0};
+static std::atomic<size_t> ws2812_closed{0};
+static std::atomic<size_t> ws2812_open_first{0};
+static std::atomic<size_t> ws2812_open_end{0};
+static std::atomic<uint64_t> ws2812_open_latch_ns{UINT64_MAX}; // UINT64_MAX when nothing is being sent
+static bool ws2812_full = false;
+
+// Wire format. The writer tracks when the state machine finishes the words it has been given.
+static unsigned int ws2812_pin;
+static unsigned int ws2812_bits;
+static uint64_t ws2812_cycle_ns;
+static MockBusWriter ws2812_wire;
+
+struct Ws2812Snapshot {
+    size_t closed;
+    size_t open_first;
+    size_t open_end;
+    uint64_t open_latch_ns;
+};
+
+static Ws2812Snapshot ws2812_snapshot()
+{
+    Ws2812Snapshot snapshot;
+    uint32_t seq;
+    do {
+        while ((seq = ws2812_seq.load(std::memory_order_acquire)) & 1) {
+        }
+        snapshot.closed = ws2812_closed.load(std::memory_order_relaxed);
+        snapshot.open_first = ws2812_open_first.load(std::memory_order_relaxed);
+        snapshot.open_end = ws2812_open_end.load(std::memory_order_relaxed);
+        snapshot.open_latch_ns = ws2812_open_latch_ns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (seq != ws2812_seq.load(std::memory_order_relaxed));
+    return snapshot;
+}
+
+static void ws2812_print_frame(size_t first, size_t leds, uint64_t latch_us)
+{
+    printf("Debug: LEDs latched at %.6f s (R,G,B) = ", latch_us / 1e6);
+    for (size_t i = 0; i < std::min(leds, (size_t)WS2812_PRINT_LEDS); i++) {
+        uint32_t v = ws2812_words[first + i];
+        uint8_t g = (0xFF000000 & v) >> 24; // The strip takes green first
+        uint8_t r = (0xFF0000 & v) >> 16;
+        uint8_t b = (0xFF00 & v) >> 8;
+        printf("(%03u,%03u,%03u),", r, g, b);
+    }
+    if (leds > WS2812_PRINT_LEDS) {
+        printf("... %zu LEDs", leds);
+    }
+    printf("\n");
+}
 
-// Storage for the last update 
-std::atomic<std::chrono::steady_clock::time_point> last_update;
+// The last frame has nobody to cut it off, so it is printed when the simulation ends
+static void ws2812_print_last_frame(uint64_t end_us)
+{
+    Ws2812Snapshot snapshot = ws2812_snapshot();
+    if (snapshot.open_latch_ns <= end_us * 1000) {
+        ws2812_print_frame(snapshot.open_first, snapshot.open_end - snapshot.open_first,
+                           snapshot.open_latch_ns / 1000);
+    }
+}
 
 void ws2812_program_init(PIO pio, unsigned int sm, unsigned int offset, unsigned int pin, float freq, bool rgbw)
 {
-    last_update.store(std::chrono::steady_clock::now());
-    std::thread idle_detection (ws2812_idle_detection_thread);
-    idle_detection.detach();
+    mock_pio_sm_set_program(pio, sm, offset);
+    ws2812_pin = pin;
+    ws2812_bits = rgbw ? 32 : 24;
+    ws2812_cycle_ns = (uint64_t)(1e9 / (freq * 10)); // T1 + T2 + T3 cycles per bit
+    mock_bus_register(MOCK_BUS_WS2812, pin, ws2812_bits);
+    mock_clock_on_exit(ws2812_print_last_frame);
 }
 
-void ws2812_program_impl(uint32_t data) 
+// Record the bits of one word as ws2812_program sends them: 3 cycles low, then 2 cycles high for a 0 or 7 for a 1, and
+// 5 more low for a 0
+static void ws2812_trace_word(uint32_t data)
 {
-    // Store the LED colour we received
-    std::lock_guard<std::mutex> guard(mock_ws2812_leds_mutex);
-    mock_ws2812_leds.push_back(data);
-    // Reset the idle detection timer (because the real LEDs wait for the bus to go idle before latching the colours)
-    last_update.store(std::chrono::steady_clock::now());
-    // Signal to the idle detection thread
-    mock_ws2812_semaphore.release();
+    for (unsigned int bit = 0; bit < ws2812_bits; bit++) {
+        bool one = data & (0x80000000u >> bit);
+        ws2812_wire.set(ws2812_pin, false);
+        ws2812_wire.wait(3 * ws2812_cycle_ns);
+        ws2812_wire.set(ws2812_pin, true);
+        ws2812_wire.wait((one ? 7 : 2) * ws2812_cycle_ns);
+        ws2812_wire.set(ws2812_pin, false);
+        ws2812_wire.wait((one ? 0 : 5) * ws2812_cycle_ns);
+    }
 }
 
-// Display the LED status 280us after the last message was posted. This emulates the real wire protocol where idle 
-// means to latch the latest values.
-void ws2812_idle_detection_thread()
+void ws2812_program_impl(PIO pio, unsigned int sm, uint32_t data)
 {
-    for (;;) {
-        // Wait for activity
-        mock_ws2812_semaphore.acquire();
-        std::this_thread::sleep_for(std::chrono::microseconds(280));
-        
-        for (;;) {
-            // Check that enough time has elapsed
-            auto elapsed = std::chrono::steady_clock::now() - last_update.load();
-            if (elapsed > std::chrono::microseconds(280)) {
-                std::lock_guard<std::mutex> guard(mock_ws2812_leds_mutex);
-                if (mock_ws2812_leds.size() > 0 ) {
-                    printf("Debug: LEDs (R,G,B) = ");
-
-                    for (uint32_t v : mock_ws2812_leds) {
-                        uint8_t r = (0xFF000000 & v) >> 24;
-                        uint8_t g = (0xFF0000 & v) >> 16;
-                        uint8_t b = (0xFF00 & v) >> 8;
-                        printf("(%03u,%03u,%03u),", r, g, b);
-                    }
-                    printf("\n");
-
-                    mock_ws2812_leds.clear();
-                    break;
-                }
-            }
-
-            // Otherwise, wait 10us and try again 
-            std::this_thread::sleep_for(std::chrono::microseconds(10));
+    if (ws2812_full) {
+        return;
+    }
+    uint64_t now_ns = mock_clock_now_us() * 1000;
+    uint64_t latch_ns = ws2812_open_latch_ns.load(std::memory_order_relaxed);
+
+    ws2812_seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // The previous frame latched if the line went idle for long enough before this word
+    if (latch_ns != UINT64_MAX && now_ns >= latch_ns) {
+        size_t first = ws2812_open_first.load(std::memory_order_relaxed);
+        size_t leds = ws2812_open_end.load(std::memory_order_relaxed) - first;
+        ws2812_full = !ws2812_frames.push({first, leds, latch_ns / 1000});
+        ws2812_closed.store(ws2812_frames.size(), std::memory_order_relaxed);
+        ws2812_open_latch_ns.store(UINT64_MAX, std::memory_order_relaxed);
+        ws2812_print_frame(first, leds, latch_ns / 1000);
+    }
+    if (ws2812_open_latch_ns.load(std::memory_order_relaxed) == UINT64_MAX) {
+        ws2812_open_first.store(ws2812_words.size(), std::memory_order_relaxed);
+    }
+
+    if (ws2812_full || !ws2812_words.push(data)) {
+        printf("Debug: WS2812 capture is full, later frames are ignored\n");
+        ws2812_full = true;
+    } else {
+        ws2812_wire.begin();
+        if (mock_bus_trace_enabled()) {
+            ws2812_trace_word(data);
+        } else {
+            ws2812_wire.wait(10 * ws2812_bits * ws2812_cycle_ns);
         }
+        ws2812_open_end.store(ws2812_words.size(), std::memory_order_relaxed);
+        ws2812_open_latch_ns.store(ws2812_wire.time_ns + MOCK_WS2812_LATCH_NS, std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_release);
+    ws2812_seq.fetch_add(1, std::memory_order_release);
+
+    // Like pio_sm_put_blocking, return once the word has room in the FIFO
+    uint64_t fifo_ns = WS2812_FIFO_DEPTH * 10 * ws2812_bits * ws2812_cycle_ns;
+    if (ws2812_wire.time_ns > now_ns + fifo_ns) {
+        mock_clock_sleep_until((ws2812_wire.time_ns - fifo_ns + 999) / 1000);
     }
 }
+
+size_t mock_ws2812_frame_count()
+{
+    Ws2812Snapshot snapshot = ws2812_snapshot();
+    bool last_latched = snapshot.open_latch_ns <= mock_clock_now_us() * 1000;
+    return snapshot.closed + (last_latched ? 1 : 0);
+}
+
+bool mock_ws2812_get_frame(size_t index, MockWs2812Frame &frame)
+{
+    Ws2812Snapshot snapshot = ws2812_snapshot();
+    Ws2812FrameRecord record;
+    if (index < snapshot.closed) {
+        record = ws2812_frames[index];
+    } else if (index == snapshot.closed && snapshot.open_latch_ns <= mock_clock_now_us() * 1000) {
+        record = {snapshot.open_first, snapshot.open_end - snapshot.open_first, snapshot.open_latch_ns / 1000};
+    } else {
+        return false;
+    }
+
+    frame.latch_us = record.latch_us;
+    frame.leds.resize(record.leds);
+    for (size_t i = 0; i < record.leds; i++) {
+        frame.leds[i] = ws2812_words[record.first + i];
+    }
+    return true;
+}
+
+bool mock_ws2812_latest_frame(MockWs2812Frame &frame)
+{
+    size_t count = mock_ws2812_frame_count();
+    return count > 0 && mock_ws2812_get_frame(count - 1, frame);
+}
@@ -0,0 +1,193 @@
+// Host test: record known traffic on each mocked bus and decode it back.
+//
+// TM1637 bytes, an HX711 conversion and WS2812 frames are sent through the mocked state machines with the bus trace
+// on. The decoders must return the same bytes, count and colours, with the durations the programs' timing gives, and
+// the report must add them up into the right busy share. A WS2812 idle gap shorter than the latch time must not split a
+// frame, and the decoder must cut frames where the WS2812 mock latches them. Finally the trace is overfilled, and the
+// report must only cover the time it was recording for. The expected times assume nothing else moves the clock, so the
+// test runs in virtual time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+#include "HX711.pio.h"
+#include "TM1637.pio.h"
+#include "WS2812.pio.h"
+#include "bus_trace.h"
+#include "drivers/loadcell.h"
+
+#define TEST_TM1637_DIO 18
+#define TEST_TM1637_CLK 19
+#define TEST_HX711_DOUT 2 // As wired in loadcell.cpp
+#define TEST_HX711_SCK 3
+#define TEST_WS2812_PIN 22
+#define TEST_HX711_VALUE 0x812345
+
+static bool test_ok = true;
+
+static void test_expect(bool condition, const char *what)
+{
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        test_ok = false;
+    }
+}
+
+static void test_expect_transaction(const char *name, const MockBusTransaction &t, uint64_t start_ns,
+                                    uint64_t duration_ns, const std::vector<uint32_t> &data)
+{
+    if (t.start_ns != start_ns || t.end_ns - t.start_ns != duration_ns || t.data != data) {
+        printf("FAIL: %s: decoded %zu words from %llu ns for %llu ns, expected %zu words from %llu ns for %llu ns\n",
+               name, t.data.size(), (unsigned long long)t.start_ns, (unsigned long long)(t.end_ns - t.start_ns),
+               data.size(), (unsigned long long)start_ns, (unsigned long long)duration_ns);
+        test_ok = false;
+    }
+}
+
+// Run mock_bus_report() and return what it printed
+static std::string test_report(uint64_t end_us)
+{
+    FILE *capture = tmpfile();
+    fflush(stderr);
+    int saved = dup(STDERR_FILENO);
+    dup2(fileno(capture), STDERR_FILENO);
+    mock_bus_report(end_us);
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+
+    std::string text;
+    char line[512];
+    rewind(capture);
+    while (fgets(line, sizeof(line), capture) != nullptr) {
+        text += line;
+    }
+    fclose(capture);
+    return text;
+}
+
+static void test_expect_report_line(const std::string &report, const char *line)
+{
+    if (report.find(line) == std::string::npos) {
+        printf("FAIL: the report has no line\n    %s\nIt reads:\n%s", line, report.c_str());
+        test_ok = false;
+    }
+}
+
+// Start of a LED word with its last bit set, so the frame ends on a falling edge
+static uint32_t test_colour(uint32_t grb)
+{
+    return (grb | 1) << 8;
+}
+
+int main()
+{
+    mock_bus_trace_enable(true);
+
+    // TM1637: a data command on its own, then an address and four digits. Each byte takes 62 us of the 1 MHz program,
+    // a start condition 6 us more and a stop 6 us more, and the start itself begins 3 us into the first word. The
+    // transfers run 3 + 71 + 3 us apart.
+    PIO tm_pio = pio1;
+    unsigned int tm_offset = pio_add_program(tm_pio, &tm1637_program);
+    unsigned int tm_sm = pio_claim_unused_sm(tm_pio, true);
+    tm1637_program_init(tm_pio, tm_sm, tm_offset, TEST_TM1637_DIO, TEST_TM1637_CLK);
+    uint64_t tm_start_ns = time_us_64() * 1000;
+    const uint8_t digits[] = {0x3F, 0x06, 0x5B, 0x4F};
+    pio_sm_put_blocking(tm_pio, tm_sm, tm1637_word(0x40, true, true));
+    pio_sm_put_blocking(tm_pio, tm_sm, tm1637_word(0xC0, true, false));
+    for (int i = 0; i < 4; i++) {
+        pio_sm_put_blocking(tm_pio, tm_sm, tm1637_word(digits[i], false, i == 3));
+    }
+    std::vector<MockBusTransaction> tm = mock_bus_decode_tm1637(TEST_TM1637_CLK, TEST_TM1637_DIO);
+    test_expect(tm.size() == 2, "TM1637: two transfers");
+    if (tm.size() == 2) {
+        test_expect_transaction("TM1637 data command", tm[0], tm_start_ns + 3000, 71000, {0x40});
+        test_expect_transaction("TM1637 digits", tm[1], tm_start_ns + 77000 + 3000, 319000,
+                                {0xC0, 0x3F, 0x06, 0x5B, 0x4F});
+    }
+
+    // HX711: 25 SCK pulses of 5 us, the first 1 us after DOUT falls, ending with the last one's falling edge
+    hx711_init();
+    uint64_t hx_start_ns = time_us_64() * 1000;
+    mock_hx711_push_sample(TEST_HX711_VALUE);
+    std::vector<MockBusTransaction> hx = mock_bus_decode_hx711(TEST_HX711_SCK, TEST_HX711_DOUT);
+    test_expect(hx.size() == 1, "HX711: one conversion");
+    if (hx.size() == 1) {
+        test_expect_transaction("HX711 conversion", hx[0], hx_start_ns, 124000, {TEST_HX711_VALUE, 25});
+    }
+    int32_t raw = 0;
+    test_expect(hx711_try_read(&raw) && raw == (int32_t)(TEST_HX711_VALUE | 0xFF000000), "HX711: sample read back");
+
+    // WS2812 at 800 kHz: 1.25 us a bit, each starting with 375 ns low. Three LEDs, 100 us idle, two more LEDs: the
+    // gap is well short of the latch time, so that is one frame. Then a 1 ms gap, and a one-LED frame.
+    PIO ws_pio = pio0;
+    unsigned int ws_offset = pio_add_program(ws_pio, &ws2812_program);
+    unsigned int ws_sm = pio_claim_unused_sm(ws_pio, true);
+    ws2812_program_init(ws_pio, ws_sm, ws_offset, TEST_WS2812_PIN, 800000, false);
+    const uint32_t first[] = {test_colour(0xFF0000), test_colour(0x00FF00), test_colour(0x0000FE),
+                              test_colour(0x123456), test_colour(0xABCDEE)};
+    uint64_t ws_start_ns = time_us_64() * 1000;
+    for (int i = 0; i < 3; i++) {
+        pio_sm_put_blocking(ws_pio, ws_sm, first[i]);
+    }
+    sleep_us(3 * 30 + 100);
+    for (int i = 3; i < 5; i++) {
+        pio_sm_put_blocking(ws_pio, ws_sm, first[i]);
+    }
+    sleep_us(2 * 30 + 1000);
+    uint64_t ws_second_ns = time_us_64() * 1000;
+    pio_sm_put_blocking(ws_pio, ws_sm, test_colour(0x010203));
+    sleep_us(30 + 1000);
+
+    std::vector<MockBusTransaction> ws = mock_bus_decode_ws2812(TEST_WS2812_PIN, 24);
+    test_expect(ws.size() == 2, "WS2812: two frames");
+    test_expect(ws.size() == mock_ws2812_frame_count(), "WS2812: decoder and capture cut the same frames");
+    if (ws.size() == 2) {
+        std::vector<uint32_t> colours;
+        for (uint32_t word : first) {
+            colours.push_back(word >> 8);
+        }
+        test_expect_transaction("WS2812 frame across a short gap", ws[0], ws_start_ns + 375, 90000 + 100000 + 60000 - 375,
+                                colours);
+        test_expect_transaction("WS2812 one-LED frame", ws[1], ws_second_ns + 375, 30000 - 375,
+                                {test_colour(0x010203) >> 8});
+    }
+
+    // The report adds up the same transactions over the run so far
+    uint64_t end_us = time_us_64();
+    std::string report = test_report(end_us);
+    char line[256];
+    snprintf(line, sizeof(line), "TM1637 CLK=%u DIO=%u: 2 transfers, 0.390 ms on the wire (%.3f%% busy), mean 195.0 us, "
+             "longest 319.0 us", TEST_TM1637_CLK, TEST_TM1637_DIO, 100.0 * 390000 / (end_us * 1000));
+    test_expect_report_line(report, line);
+    snprintf(line, sizeof(line), "HX711 SCK=%u DOUT=%u: 1 conversions, 0.124 ms on the wire (%.3f%% busy)",
+             TEST_HX711_SCK, TEST_HX711_DOUT, 100.0 * 124000 / (end_us * 1000));
+    test_expect_report_line(report, line);
+    snprintf(line, sizeof(line), "WS2812 DIN=%u: 2 frames, %.3f ms on the wire (%.3f%% busy)", TEST_WS2812_PIN,
+             (249625 + 29625) / 1e6, 100.0 * (249625 + 29625) / (end_us * 1000));
+    test_expect_report_line(report, line);
+
+    // Overfill the trace with long frames: the report must stop where recording did, and leave out the frame that was
+    // being sent when it filled
+    for (int frame = 0; frame < 8; frame++) {
+        for (int led = 0; led < 4096; led++) {
+            pio_sm_put_blocking(ws_pio, ws_sm, test_colour(led));
+        }
+        sleep_ms(1);
+    }
+    report = test_report(time_us_64());
+    test_expect_report_line(report, "Debug: bus trace filled up at");
+    test_expect_report_line(report, ": 8 frames (7 in the recorded window)");
+
+    if (test_ok) {
+        printf("bus trace: every bus decoded as sent\n");
+    }
+    return test_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
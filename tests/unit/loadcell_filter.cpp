@@ -0,0 +1,114 @@
+// Host test: drive the load cell filter stage with step and spike sequences.
+//
+// Each filter is primed at zero and then fed a step to 1000 counts, and the outputs are compared sample by sample
+// with what the filter must produce. The median must also hold through an isolated spike, and outlier rejection must
+// hold the output through short spikes but follow a step that persists past max_rejected samples.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "drivers/loadcell.h"
+
+#define FILTER_STEP 1000
+
+// Feed `n` samples and compare every output with `expected`
+static bool filter_check(const char *name, const int32_t *input, const int32_t *expected, size_t n)
+{
+    bool ok = true;
+    for (size_t i = 0; i < n; i++) {
+        int32_t out = lc_filter_push(input[i]);
+        if (out != expected[i]) {
+            printf("FAIL: %s: sample %zu (%ld) gave %ld, expected %ld\n", name, i, (long)input[i], (long)out,
+                   (long)expected[i]);
+            ok = false;
+        }
+    }
+    if (lc_filter_output() != expected[n - 1]) {
+        printf("FAIL: %s: lc_filter_output() is %ld after the sequence\n", name, (long)lc_filter_output());
+        ok = false;
+    }
+    return ok;
+}
+
+static void filter_use(LcFilterType type, size_t window, int iir_shift, int32_t outlier_threshold,
+                       uint32_t max_rejected)
+{
+    LcFilterConfig config = {type, window, iir_shift, outlier_threshold, max_rejected};
+    lc_filter_configure(&config);
+}
+
+int main()
+{
+    bool ok = true;
+
+    // Moving average of 4: the step ramps in over the window
+    filter_use(LC_FILTER_MOVING_AVERAGE, 4, 0, 0, 0);
+    {
+        const int32_t in[] = {0, FILTER_STEP, FILTER_STEP, FILTER_STEP, FILTER_STEP, FILTER_STEP};
+        const int32_t out[] = {0, 250, 500, 750, 1000, 1000};
+        ok &= filter_check("moving average step", in, out, sizeof(in) / sizeof(in[0]));
+    }
+
+    // A window outside 1 to LC_FILTER_MAX_WINDOW is clamped; a window of 1 passes samples straight through
+    filter_use(LC_FILTER_MOVING_AVERAGE, 0, 0, 0, 0);
+    {
+        const int32_t in[] = {5, -7, 12};
+        const int32_t out[] = {5, -7, 12};
+        ok &= filter_check("moving average window 1", in, out, sizeof(in) / sizeof(in[0]));
+    }
+
+    // Median of 5: a lone spike either way is ignored, a step comes through once it fills half the window
+    filter_use(LC_FILTER_MEDIAN, 5, 0, 0, 0);
+    {
+        const int32_t in[] = {0, 0, 9999, 0, -9999, 0, FILTER_STEP, FILTER_STEP, FILTER_STEP, FILTER_STEP};
+        const int32_t out[] = {0, 0, 0, 0, 0, 0, 0, 0, FILTER_STEP, FILTER_STEP};
+        ok &= filter_check("median spike and step", in, out, sizeof(in) / sizeof(in[0]));
+    }
+
+    // IIR with a shift of 2: each sample moves the output a quarter of the remaining error, rounded down
+    filter_use(LC_FILTER_IIR, 1, 2, 0, 0);
+    {
+        const int32_t in[] = {0, FILTER_STEP, FILTER_STEP, FILTER_STEP, FILTER_STEP};
+        const int32_t out[] = {0, 250, 437, 578, 683};
+        ok &= filter_check("IIR step", in, out, sizeof(in) / sizeof(in[0]));
+    }
+    // ...and settles on the input without a residual error
+    int32_t settled = 0;
+    for (int i = 0; i < 100; i++) {
+        settled = lc_filter_push(FILTER_STEP);
+    }
+    if (settled != FILTER_STEP) {
+        printf("FAIL: IIR settled at %ld, expected %d\n", (long)settled, FILTER_STEP);
+        ok = false;
+    }
+
+    // Outlier hold: spikes of up to max_rejected samples hold the last output; a longer step re-primes the filter
+    filter_use(LC_FILTER_MOVING_AVERAGE, 4, 0, 100, 3);
+    uint32_t rejected = lc_filter_rejected_count();
+    {
+        const int32_t in[] = {0, 40, 5000, 40, -5000, -5000, -5000, 40,
+                              FILTER_STEP, FILTER_STEP, FILTER_STEP, FILTER_STEP, FILTER_STEP};
+        const int32_t out[] = {0, 10, 10, 20, 20, 20, 20, 30,
+                               30, 30, 30, FILTER_STEP, FILTER_STEP};
+        ok &= filter_check("outlier hold", in, out, sizeof(in) / sizeof(in[0]));
+    }
+    // Every sample past the threshold counts, including the one that ends a hold by accepting the step
+    rejected = lc_filter_rejected_count() - rejected;
+    if (rejected != 8) {
+        printf("FAIL: %lu samples counted as outliers, expected 8\n", (unsigned long)rejected);
+        ok = false;
+    }
+
+    // Reset discards the history, so the next sample primes the filter again
+    lc_filter_reset();
+    {
+        const int32_t in[] = {-FILTER_STEP, -FILTER_STEP};
+        const int32_t out[] = {-FILTER_STEP, -FILTER_STEP};
+        ok &= filter_check("reset", in, out, sizeof(in) / sizeof(in[0]));
+    }
+
+    if (ok) {
+        printf("filter stage: all sequences matched\n");
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
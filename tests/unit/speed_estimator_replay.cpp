@@ -0,0 +1,151 @@
+// Host test: replay recorded ultrasonic distance traces through the speed estimator.
+//
+//     speed_estimator_replay trace.csv...
+//
+// The `distance` lines of each trace (in the format of tests/mocks/stimulus.h) are fed to the estimator at their
+// timestamps. The traces record a car moving at a steady speed, so a straight line fitted to all of a trace's samples
+// gives the true speed. Once the track has settled, the estimate must stay close to it and be much steadier than the
+// finite difference of consecutive readings that the estimator replaced. The trace is then replayed again with a
+// glitch in the middle, which must be rejected without disturbing the estimate.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "drivers/speed_estimator.h"
+
+#define REPLAY_SETTLE_SAMPLES 10      // Samples before the estimate is checked
+#define REPLAY_MAX_SPEED_ERROR 0.10   // Largest error allowed once settled, as a fraction of the true speed
+#define REPLAY_MIN_NOISE_REDUCTION 3  // Finite-difference noise must be at least this many times the estimator's
+#define REPLAY_GLITCH_MM 900
+
+struct DistanceSample {
+    uint64_t time_us;
+    uint16_t distance_mm;
+};
+
+static bool load_trace(const char *path, std::vector<DistanceSample> &samples)
+{
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) {
+        printf("FAIL: cannot open %s\n", path);
+        return false;
+    }
+    char line[256];
+    double time_s;
+    unsigned int distance_mm;
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        if (sscanf(line, "%lf,distance,%u", &time_s, &distance_mm) == 2) {
+            samples.push_back({(uint64_t)llround(time_s * 1e6), (uint16_t)distance_mm});
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// Least-squares slope of distance against time, in mm/s
+static double fitted_speed(const std::vector<DistanceSample> &samples)
+{
+    double n = samples.size(), sum_t = 0, sum_d = 0, sum_tt = 0, sum_td = 0;
+    for (const DistanceSample &s : samples) {
+        double t = s.time_us / 1e6;
+        sum_t += t;
+        sum_d += s.distance_mm;
+        sum_tt += t * t;
+        sum_td += t * s.distance_mm;
+    }
+    return (n * sum_td - sum_t * sum_d) / (n * sum_tt - sum_t * sum_t);
+}
+
+static double rms(const std::vector<double> &errors)
+{
+    double sum = 0;
+    for (double e : errors) {
+        sum += e * e;
+    }
+    return sqrt(sum / errors.size());
+}
+
+static bool replay(const char *path)
+{
+    std::vector<DistanceSample> samples;
+    if (!load_trace(path, samples)) {
+        return false;
+    }
+    if (samples.size() < 2 * REPLAY_SETTLE_SAMPLES) {
+        printf("FAIL: %s has only %zu distance samples\n", path, samples.size());
+        return false;
+    }
+    double speed = fitted_speed(samples);
+
+    // The estimator against the finite difference it replaced
+    std::vector<double> est_errors, diff_errors;
+    double worst = 0;
+    speed_est_reset();
+    for (size_t i = 0; i < samples.size(); i++) {
+        speed_est_update(samples[i].distance_mm, samples[i].time_us);
+        if (i < REPLAY_SETTLE_SAMPLES) {
+            continue;
+        }
+        double error = speed_est_get().velocity_mm_s - speed;
+        est_errors.push_back(error);
+        worst = fmax(worst, fabs(error));
+        double dt = (samples[i].time_us - samples[i - 1].time_us) / 1e6;
+        diff_errors.push_back(((double)samples[i].distance_mm - samples[i - 1].distance_mm) / dt - speed);
+    }
+    printf("%s: %zu samples, true speed %.1f mm/s; estimator rms error %.1f mm/s (worst %.1f), "
+           "finite difference rms error %.1f mm/s\n",
+           path, samples.size(), speed, rms(est_errors), worst, rms(diff_errors));
+
+    bool ok = true;
+    if (worst > REPLAY_MAX_SPEED_ERROR * fabs(speed)) {
+        printf("FAIL: estimate more than %.0f%% out\n", REPLAY_MAX_SPEED_ERROR * 100);
+        ok = false;
+    }
+    if (rms(diff_errors) < REPLAY_MIN_NOISE_REDUCTION * rms(est_errors)) {
+        printf("FAIL: estimate not much steadier than the finite difference\n");
+        ok = false;
+    }
+
+    // Again with one reading replaced by a glitch, which must be rejected and leave the estimate alone
+    size_t glitch = samples.size() / 2;
+    uint32_t rejected = speed_est_rejected_count();
+    speed_est_reset();
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (i == glitch) {
+            float before = speed_est_get().velocity_mm_s;
+            uint16_t distance = (uint16_t)(samples[i].distance_mm + REPLAY_GLITCH_MM);
+            if (speed_est_update(distance, samples[i].time_us) || speed_est_get().velocity_mm_s != before) {
+                printf("FAIL: glitch at %.3f s was not rejected\n", samples[i].time_us / 1e6);
+                ok = false;
+            }
+        } else {
+            speed_est_update(samples[i].distance_mm, samples[i].time_us);
+        }
+    }
+    if (speed_est_rejected_count() != rejected + 1) {
+        printf("FAIL: expected 1 rejected sample, got %lu\n", (unsigned long)(speed_est_rejected_count() - rejected));
+        ok = false;
+    }
+    double error = speed_est_get().velocity_mm_s - speed;
+    if (fabs(error) > REPLAY_MAX_SPEED_ERROR * fabs(speed)) {
+        printf("FAIL: estimate %.1f mm/s out at the end of the trace with a glitch\n", error);
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s trace.csv...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    bool ok = true;
+    for (int i = 1; i < argc; i++) {
+        ok = replay(argv[i]) && ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
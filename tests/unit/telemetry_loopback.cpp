@@ -0,0 +1,87 @@
+// Host test, sending side: frame a fixed set of telemetry records through the real encoder and UART queue, with console
+// text and log messages between them, so tests/unit/telemetry_loopback.py can check that tools/telemetry.py decodes
+// exactly what was sent, and that logdecode passes the frames through. The records and their values must match
+// EXPECTED in that script, and the log messages LOGS.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "drivers/uart_tx.h"
+#include "drivers/logging/logging.h"
+#include "drivers/telemetry/telemetry.h"
+#include "drivers/telemetry/telemetry_batch.h"
+
+#define LOOPBACK_BAUD 115200
+#define LOOPBACK_RAW_TYPE 0x7E // Not a defined record type, so the parser returns its payload as is
+#define LOOPBACK_LOGS 8
+
+// The harness's printf bypasses the UART queue, so let the queue empty first to keep text out of the frames
+static void loopback_console(const char *text)
+{
+    while (uart_tx_pending() > 0) {
+        sleep_ms(1);
+    }
+    printf("%s\n", text);
+}
+
+// Print the queued log messages. Binary records go through the UART queue, text lines bypass it like console text.
+static void loopback_logs()
+{
+    while (uart_tx_pending() > 0) {
+        sleep_ms(1);
+    }
+    logDrain(LOOPBACK_LOGS);
+}
+
+int main()
+{
+    uart_init(uart0, LOOPBACK_BAUD);
+    uart_tx_init(uart0, UART_TX_BLOCK);
+
+    loopback_console("console text before the first frame");
+    telemetry_send_weight(-1234, true);
+    telemetry_send_weight(0, false); // A payload of zero bytes, all of which COBS must stuff
+    telemetry_send_lap(65432);
+    loopback_console("console text between frames");
+    telemetry_send_speed(-250);
+    telemetry_send_distance(0);
+    telemetry_send_distance(65535);
+
+    // Log messages next to a frame full of 0xFE, the binary log marker: -2 g is FE FF FF FF
+    LOG_INFO(MODULE_MAIN, "Loopback log before a frame: %d", -2);
+    loopback_logs();
+    telemetry_send_weight(-2, true);
+    LOG_WARNING(MODULE_MAIN, "Loopback log after a frame: %u %s", 254u, "end");
+    loopback_logs();
+
+    // The largest payload, cycling through every byte value, zero included
+    uint8_t raw[TELEMETRY_MAX_PAYLOAD];
+    for (size_t i = 0; i < sizeof(raw); i++) {
+        raw[i] = (uint8_t)i;
+    }
+    telemetry_send((TelemetryType)LOOPBACK_RAW_TYPE, raw, sizeof(raw));
+
+    // Payloads longer than a record can carry are refused
+    static uint8_t too_long[TELEMETRY_MAX_PAYLOAD + 1];
+    if (telemetry_send((TelemetryType)LOOPBACK_RAW_TYPE, too_long, sizeof(too_long))) {
+        fprintf(stderr, "FAIL: oversized payload was sent\n");
+        return EXIT_FAILURE;
+    }
+
+    telemetry_batch_set_mode(CHANNEL_WEIGHT, BATCH_SUMMARY);
+    telemetry_batch_set_mode(CHANNEL_DISTANCE, BATCH_RAW);
+    telemetry_batch_set_mode(CHANNEL_SPEED, BATCH_OFF);
+    telemetry_batch_set_mode(CHANNEL_LAP, BATCH_OFF);
+    telemetry_batch_add(CHANNEL_WEIGHT, 100);
+    telemetry_batch_add(CHANNEL_WEIGHT, -50);
+    telemetry_batch_add(CHANNEL_WEIGHT, 250);
+    telemetry_batch_add(CHANNEL_DISTANCE, 1500);
+    telemetry_batch_add(CHANNEL_DISTANCE, 1490);
+    telemetry_batch_flush();
+
+    loopback_console("console text after the last frame");
+    fflush(stdout);
+    return telemetry_records_sent() == 9 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Host test, receiving side: run the telemetry_loopback sender and decode its output with tools/telemetry.py.
+
+    python3 telemetry_loopback.py path/to/telemetry_loopback path/to/logdecode
+
+Every record the sender framed must come back with the same type and fields, in order, with consecutive sequence
+numbers, and the console text and log messages around the frames must be skipped. A copy of the stream with one byte
+of a frame corrupted must lose that record only. The stream is also run through logdecode, which must print the log
+messages, whether they were sent as text or binary records, and pass every frame through untouched.
+"""
+
+import io
+import os
+import subprocess
+import sys
+import tempfile
+
+TOOLS = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', 'tools')
+sys.path.insert(0, TOOLS)
+import telemetry  # noqa: E402
+
+RAW_TYPE = 0x7E
+
+# Must match what tests/unit/telemetry_loopback.cpp sends. Batched raw samples carry their time in the window, which
+# varies, so only their values are compared.
+EXPECTED = [
+    (telemetry.TELEM_WEIGHT, {'weight_g': -1234, 'flags': 1}),
+    (telemetry.TELEM_WEIGHT, {'weight_g': 0, 'flags': 0}),
+    (telemetry.TELEM_LAP, {'lap_ms': 65432}),
+    (telemetry.TELEM_SPEED, {'speed_mm_s': -250}),
+    (telemetry.TELEM_DISTANCE, {'distance_mm': 0}),
+    (telemetry.TELEM_DISTANCE, {'distance_mm': 65535}),
+    (telemetry.TELEM_WEIGHT, {'weight_g': -2, 'flags': 1}),
+    (RAW_TYPE, {'raw': bytes(i & 0xFF for i in range(192))}),
+    (telemetry.TELEM_BATCH, {'weight': {'count': 3, 'min': -50, 'max': 250, 'mean': 100},
+                             'distance': [1500, 1490]}),
+]
+
+# The log messages the sender writes around the -2 g frame, as logdecode must print them
+LOGS = [
+    b'Information]: Loopback log before a frame: -2\n',
+    b'Warning]: Loopback log after a frame: 254 end\n',
+]
+
+
+def comparable(record):
+    """The fields of a record in the form EXPECTED uses."""
+    if record.type != telemetry.TELEM_BATCH:
+        return record.fields
+    channels = dict(record.fields['channels'])
+    if 'distance' in channels:
+        channels['distance'] = [value for _, value in channels['distance']['samples']]
+    return channels
+
+
+def check(records, expected):
+    failures = []
+    if len(records) != len(expected):
+        failures.append(f'decoded {len(records)} records, expected {len(expected)}')
+    for i, (record, (rtype, fields)) in enumerate(zip(records, expected)):
+        if record.type != rtype or comparable(record) != fields:
+            failures.append(f'record {i}: got type {record.type} {comparable(record)}, expected type {rtype} {fields}')
+    for a, b in zip(records, records[1:]):
+        if b.sequence != (a.sequence + 1) & 0xFF:
+            failures.append(f'sequence {a.sequence} followed by {b.sequence}')
+    return failures
+
+
+def decode_logs(logdecode, sender_source, stream):
+    """Run the stream through logdecode, with the format table of the sender's log messages."""
+    with tempfile.TemporaryDirectory() as tmp:
+        formats = os.path.join(tmp, 'log_formats.txt')
+        subprocess.run([sys.executable, os.path.join(TOOLS, 'log_extract.py'), '-o', formats, sender_source],
+                       check=True)
+        return subprocess.run([logdecode, formats], input=stream, stdout=subprocess.PIPE, check=True).stdout
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__, file=sys.stderr)
+        return 2
+    result = subprocess.run([sys.argv[1]], stdout=subprocess.PIPE, check=False)
+    if result.returncode != 0:
+        print(f'FAIL: sender exited with {result.returncode}')
+        return 1
+    stream = result.stdout
+
+    failures = check(list(telemetry.read_records(io.BytesIO(stream))), EXPECTED)
+    if b'console text between frames' not in stream:
+        failures.append('console text missing from the stream')
+
+    # Flip one byte in the middle of the third frame: the lap record must be dropped and everything else kept
+    starts = [i + 1 for i, b in enumerate(stream) if b == 0 and i + 1 < len(stream) and stream[i + 1] != 0]
+    corrupt = bytearray(stream)
+    corrupt[starts[2] + 4] ^= 0x55
+    records = list(telemetry.read_records(io.BytesIO(bytes(corrupt))))
+    expected = EXPECTED[:2] + EXPECTED[3:]
+    if len(records) != len(expected) or any(r.type != t or comparable(r) != f for r, (t, f) in zip(records, expected)):
+        failures.append(f'corrupted stream decoded as {[(r.type, comparable(r)) for r in records]}')
+
+    # logdecode prints the log messages and leaves the frames as they were
+    decoded = decode_logs(sys.argv[2], os.path.splitext(os.path.abspath(__file__))[0] + '.cpp', stream)
+    failures += [f'logdecode: {line}' for line in check(list(telemetry.read_records(io.BytesIO(decoded))), EXPECTED)]
+    for log in LOGS:
+        if decoded.count(log) != 1:
+            failures.append(f'logdecode printed {log!r} {decoded.count(log)} times')
+    if b'<unknown message' in decoded:
+        failures.append('logdecode decoded part of a frame as a log message')
+
+    for failure in failures:
+        print('FAIL:', failure)
+    if not failures:
+        print(f'{len(EXPECTED)} records sent and decoded, {len(stream)} bytes, corrupted frame rejected')
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
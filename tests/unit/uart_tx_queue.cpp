@@ -0,0 +1,207 @@
+// Host test: the UART transmit queue under each overflow policy.
+//
+// uart0 is slowed right down, so the first record of each burst stays with the DMA while the rest overfill the 2 KiB
+// ring. A model of the queue says which records each policy must keep; once the UART is let go, exactly those bytes
+// must reach it, in order, and the drop counts and high-water mark must agree. Dropping the oldest records compacts
+// the ring in place, so those bursts use records of varying length that wrap around the end of the ring. A burst under
+// the blocking policy must arrive whole.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <vector>
+
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "drivers/uart_tx.h"
+
+#define QUEUE_RING_SIZE 2048  // UART_TX_RING_SIZE in uart_tx.cpp
+#define QUEUE_MAX_RECORDS 64  // UART_TX_MAX_RECORDS in uart_tx.cpp
+#define QUEUE_SLOW_BYTES_PER_S 200 // Holds the first record of a burst for at least 5 ms per byte
+#define QUEUE_BLOCK_BYTES_PER_S 20000
+
+typedef std::vector<uint8_t> Record;
+
+// What the queue must do with a burst written while the first record is being sent
+struct Expected {
+    std::vector<bool> written; // What uart_tx_write() returns for each record
+    Record sent;
+    uint32_t dropped;
+    uint32_t bytes_dropped;
+    uint32_t high_water;
+};
+
+static std::vector<Record> queue_burst(unsigned int count, size_t min_length, size_t max_length)
+{
+    static unsigned int next_id = 0;
+    std::vector<Record> records;
+    for (unsigned int i = 0; i < count; i++, next_id++) {
+        Record record(min_length + (i * 13) % (max_length - min_length + 1));
+        for (size_t j = 0; j < record.size(); j++) {
+            record[j] = (uint8_t)(next_id * 31 + j * 7);
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+static Expected queue_model(UartTxPolicy policy, const std::vector<Record> &records)
+{
+    Expected e = {std::vector<bool>(records.size(), true), {}, 0, 0, 0};
+    std::vector<bool> kept(records.size(), true);
+    size_t in_flight = records[0].size();
+    std::deque<size_t> queued;
+    size_t queued_bytes = 0;
+    e.high_water = in_flight;
+
+    for (size_t i = 1; i < records.size(); i++) {
+        size_t length = records[i].size();
+        auto fits = [&] {
+            return in_flight + queued_bytes + length <= QUEUE_RING_SIZE && queued.size() < QUEUE_MAX_RECORDS;
+        };
+        while (!fits() && policy == UART_TX_DROP_OLDEST && !queued.empty()) {
+            kept[queued.front()] = false;
+            queued_bytes -= records[queued.front()].size();
+            e.dropped++;
+            e.bytes_dropped += records[queued.front()].size();
+            queued.pop_front();
+        }
+        if (!fits()) {
+            e.written[i] = kept[i] = false;
+            e.dropped++;
+            e.bytes_dropped += length;
+            continue;
+        }
+        queued.push_back(i);
+        queued_bytes += length;
+        if (in_flight + queued_bytes > e.high_water) {
+            e.high_water = in_flight + queued_bytes;
+        }
+    }
+
+    for (size_t i = 0; i < records.size(); i++) {
+        if (kept[i]) {
+            e.sent.insert(e.sent.end(), records[i].begin(), records[i].end());
+        }
+    }
+    return e;
+}
+
+// Wait for the DMA to send everything, and return what reached the UART
+static Record queue_drain()
+{
+    while (uart_tx_pending() > 0) {
+        sleep_ms(1);
+    }
+    Record sent(64 * 1024);
+    sent.resize(mock_uart_take_sent(uart0, sent.data(), sent.size()));
+    return sent;
+}
+
+static bool queue_check_sent(const char *name, const Record &sent, const Record &expected)
+{
+    if (sent == expected) {
+        return true;
+    }
+    size_t i = 0;
+    while (i < sent.size() && i < expected.size() && sent[i] == expected[i]) {
+        i++;
+    }
+    printf("FAIL: %s: %zu bytes reached the UART, expected %zu; first difference at byte %zu\n", name, sent.size(),
+           expected.size(), i);
+    return false;
+}
+
+// Overfill the queue under a drop policy and compare the outcome with the model
+static bool queue_overfill(const char *name, UartTxPolicy policy, unsigned int count, size_t min_length,
+                           size_t max_length)
+{
+    std::vector<Record> records = queue_burst(count, min_length, max_length);
+    Expected e = queue_model(policy, records);
+    UartTxStats before = uart_tx_stats();
+
+    uart_tx_set_policy(policy);
+    mock_uart_set_bandwidth(uart0, QUEUE_SLOW_BYTES_PER_S);
+    bool ok = true;
+    uint32_t written = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        bool result = uart_tx_write(records[i].data(), records[i].size());
+        written += result;
+        if (result != e.written[i]) {
+            printf("FAIL: %s: writing record %zu returned %d\n", name, i, result);
+            ok = false;
+        }
+    }
+    mock_uart_set_bandwidth(uart0, 0);
+    ok &= queue_check_sent(name, queue_drain(), e.sent);
+
+    UartTxStats after = uart_tx_stats();
+    uint32_t high_water = e.high_water > before.high_water ? e.high_water : before.high_water;
+    if (after.records_queued - before.records_queued != written ||
+        after.bytes_queued - before.bytes_queued < e.sent.size() ||
+        after.records_dropped - before.records_dropped != e.dropped ||
+        after.bytes_dropped - before.bytes_dropped != e.bytes_dropped || after.high_water != high_water) {
+        printf("FAIL: %s: stats queued %lu, dropped %lu (%lu bytes), high water %lu; expected %lu, %lu (%lu bytes), "
+               "%lu\n", name, (unsigned long)(after.records_queued - before.records_queued),
+               (unsigned long)(after.records_dropped - before.records_dropped),
+               (unsigned long)(after.bytes_dropped - before.bytes_dropped), (unsigned long)after.high_water,
+               (unsigned long)written, (unsigned long)e.dropped, (unsigned long)e.bytes_dropped,
+               (unsigned long)high_water);
+        ok = false;
+    }
+    printf("%s: %u records, %lu dropped, %zu bytes sent\n", name, count, (unsigned long)e.dropped, e.sent.size());
+    return ok;
+}
+
+// Write a burst several times the ring's size under the blocking policy: every byte must arrive
+static bool queue_block()
+{
+    std::vector<Record> records = queue_burst(200, 17, 63);
+    Record expected;
+    UartTxStats before = uart_tx_stats();
+
+    uart_tx_set_policy(UART_TX_BLOCK);
+    mock_uart_set_bandwidth(uart0, QUEUE_BLOCK_BYTES_PER_S);
+    bool ok = true;
+    for (const Record &record : records) {
+        ok &= uart_tx_write(record.data(), record.size());
+        expected.insert(expected.end(), record.begin(), record.end());
+    }
+    ok &= queue_check_sent("block", queue_drain(), expected);
+    mock_uart_set_bandwidth(uart0, 0);
+
+    UartTxStats after = uart_tx_stats();
+    if (after.records_dropped != before.records_dropped || after.high_water > QUEUE_RING_SIZE) {
+        printf("FAIL: block: %lu records dropped, high water %lu\n",
+               (unsigned long)(after.records_dropped - before.records_dropped), (unsigned long)after.high_water);
+        ok = false;
+    }
+    printf("block: %zu records, %zu bytes sent\n", records.size(), expected.size());
+    return ok;
+}
+
+int main()
+{
+    uart_init(uart0, 115200);
+    uart_tx_init(uart0, UART_TX_BLOCK);
+    mock_uart_capture(uart0, true);
+
+    bool ok = true;
+    ok &= queue_overfill("drop newest", UART_TX_DROP_NEWEST, 120, 17, 63);
+    ok &= queue_overfill("drop newest, record limit", UART_TX_DROP_NEWEST, 100, 1, 4);
+    ok &= queue_overfill("drop oldest", UART_TX_DROP_OLDEST, 150, 17, 63);
+    ok &= queue_overfill("drop oldest, record limit", UART_TX_DROP_OLDEST, 100, 1, 4);
+    ok &= queue_overfill("drop oldest, after wrapping", UART_TX_DROP_OLDEST, 150, 30, 90);
+    ok &= queue_block();
+
+    // A record larger than the ring can never be sent, whatever the policy
+    Record oversized(QUEUE_RING_SIZE + 1, 0x55);
+    UartTxStats before = uart_tx_stats();
+    if (uart_tx_write(oversized.data(), oversized.size()) || uart_tx_stats().records_dropped != before.records_dropped + 1) {
+        printf("FAIL: a record larger than the ring was not dropped\n");
+        ok = false;
+    }
+    ok &= queue_check_sent("oversized", queue_drain(), Record());
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
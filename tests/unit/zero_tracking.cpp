@@ -0,0 +1,92 @@
+// Host test: automatic zero tracking across a boot from stored calibration, a load, an unload and slow drift.
+//
+// A calibration saved by a "previous boot" is loaded, and conversions are fed at the HX711's 10 Hz through the real
+// stream and filter. After a load comes off, the zero must follow a drift of 0.3 d/s until the empty scale reads zero
+// again. A small load that sits still must not be tracked away, and drift faster than 0.5 d/s must not be followed.
+// The checks depend on when corrections happen, so the test runs in virtual time.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pico/stdlib.h"
+#include "HX711.pio.h"
+#include "drivers/calibration_store.h"
+#include "drivers/loadcell.h"
+
+#define ZT_SAMPLE_MS 100
+#define ZT_FACTOR 100000.0f // Counts per kg, so 1 g (one division) is 100 counts
+#define ZT_COUNTS_PER_G 100
+#define ZT_TARE 8000
+
+static int32_t zt_raw = ZT_TARE;
+
+// Feed `ms` of conversions, moving the raw reading by `counts_per_s` as they go
+static void zt_run(uint32_t ms, int32_t counts_per_s)
+{
+    for (uint32_t t = 0; t < ms; t += ZT_SAMPLE_MS) {
+        zt_raw += counts_per_s * ZT_SAMPLE_MS / 1000;
+        mock_hx711_push_sample(zt_raw);
+        lc_poll();
+        sleep_ms(ZT_SAMPLE_MS);
+    }
+}
+
+static bool zt_expect(const char *phase, int32_t min_g, int32_t max_g)
+{
+    int32_t weight_g = lc_get_filtered_weight_g();
+    if (weight_g < min_g || weight_g > max_g) {
+        printf("FAIL: %s: reads %ld g, expected %ld to %ld g\n", phase, (long)weight_g, (long)min_g, (long)max_g);
+        return false;
+    }
+    printf("%s: %ld g\n", phase, (long)weight_g);
+    return true;
+}
+
+int main()
+{
+    // The previous boot's calibration, as the firmware would have saved it
+    CalibrationData stored = {ZT_TARE, ZT_FACTOR};
+    if (!calibration_save(&stored)) {
+        printf("FAIL: could not save the calibration\n");
+        return EXIT_FAILURE;
+    }
+
+    hx711_init();
+    lc_stream_start();
+    if (!lc_load_calibration()) {
+        printf("FAIL: could not load the stored calibration\n");
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    zt_run(3000, 0);
+    ok &= zt_expect("empty after boot", 0, 0);
+
+    // Place and remove a 500 g load
+    zt_raw += 500 * ZT_COUNTS_PER_G;
+    zt_run(3000, 0);
+    ok &= zt_expect("500 g load", 500, 500);
+    zt_raw -= 500 * ZT_COUNTS_PER_G;
+    zt_run(3000, 0);
+    ok &= zt_expect("unloaded", 0, 0);
+
+    // Drift 6 g at 0.3 d/s; the zero follows it, so the empty scale still reads zero once it stops
+    zt_run(20000, 30);
+    zt_run(3000, 0);
+    ok &= zt_expect("after slow drift", 0, 0);
+
+    // A 3 g load is outside the zero band, so it is never tracked
+    zt_raw += 3 * ZT_COUNTS_PER_G;
+    zt_run(10000, 0);
+    ok &= zt_expect("3 g load left on the scale", 3, 3);
+    zt_raw -= 3 * ZT_COUNTS_PER_G;
+    zt_run(3000, 0);
+    ok &= zt_expect("3 g load removed", 0, 0);
+
+    // Drift of 2 d/s is faster than tracking may correct, so it shows up in the reading
+    zt_run(3000, 200);
+    zt_run(3000, 0);
+    ok &= zt_expect("after fast drift", 5, 6);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Build the table of deferred log format strings used to decode binary logs.
+
+Scans the given source files for logDeferred() and LOG_*() calls and writes one line per format string:
+    <message id in hex>\t<format string, with \\, \\n, \\r and \\t escaped>
+The message id must match logMessageId() in src/drivers/logging/logging.cpp.
+"""
+
+import argparse
+import re
+import sys
+
+# One or more adjacent string literals
+LITERALS = r'((?:"(?:[^"\\]|\\.)*"\s*)+)'
+# logDeferred(LEVEL, "format" ..., LOG_INFO(MODULE, "format" ... and logDeferredModule(MODULE, LEVEL, "format" ...
+CALL_RE = re.compile(r'\b(?:logDeferred|LOG_(?:VERBOSE|INFO|WARNING|ERROR))\s*\(\s*[\w:]+\s*,\s*' + LITERALS +
+                     r'|\blogDeferredModule\s*\(\s*[\w:]+\s*,\s*[\w:]+\s*,\s*' + LITERALS, re.S)
+LITERAL_RE = re.compile(r'"((?:[^"\\]|\\.)*)"', re.S)
+ESCAPES = {'n': '\n', 't': '\t', 'r': '\r', '\\': '\\', '"': '"', "'": "'", '?': '?', 'a': '\a', 'b': '\b',
+           'f': '\f', 'v': '\v'}
+
+
+def unescape(text):
+    """Decode the escape sequences of a C string literal."""
+    out = []
+    i = 0
+    while i < len(text):
+        c = text[i]
+        if c != '\\':
+            out.append(c)
+            i += 1
+            continue
+        nxt = text[i + 1]
+        if nxt in ESCAPES:
+            out.append(ESCAPES[nxt])
+            i += 2
+        elif nxt == 'x':
+            m = re.match(r'[0-9a-fA-F]+', text[i + 2:])
+            out.append(chr(int(m.group(0), 16)))
+            i += 2 + len(m.group(0))
+        else:
+            m = re.match(r'[0-7]{1,3}', text[i + 1:])
+            out.append(chr(int(m.group(0), 8)))
+            i += 1 + len(m.group(0))
+    return ''.join(out)
+
+
+def message_id(fmt):
+    """FNV-1a of the format string, folded to 16 bits."""
+    h = 2166136261
+    for b in fmt.encode('latin-1'):
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    return ((h >> 16) ^ h) & 0xFFFF
+
+
+def escape(fmt):
+    return fmt.replace('\\', '\\\\').replace('\n', '\\n').replace('\r', '\\r').replace('\t', '\\t')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('sources', nargs='+')
+    parser.add_argument('-o', '--output', required=True)
+    args = parser.parse_args()
+
+    table = {}
+    ok = True
+    for path in args.sources:
+        with open(path, encoding='utf-8', errors='replace') as f:
+            text = f.read()
+        for call in CALL_RE.finditer(text):
+            fmt = ''.join(unescape(lit) for lit in LITERAL_RE.findall(call.group(1) or call.group(2)))
+            mid = message_id(fmt)
+            if mid in table and table[mid] != fmt:
+                print(f'{path}: message id {mid:04x} of "{escape(fmt)}" collides with "{escape(table[mid])}"',
+                      file=sys.stderr)
+                ok = False
+            table[mid] = fmt
+
+    with open(args.output, 'w', encoding='latin-1') as f:
+        for mid in sorted(table):
+            f.write(f'{mid:04x}\t{escape(table[mid])}\n')
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
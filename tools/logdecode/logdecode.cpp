@@ -0,0 +1,235 @@
+// Host tool: turn the binary log stream written by the logging driver (built with LOG_BINARY=1) back into text.
+//
+//     logdecode log_formats.txt [capture.bin]
+//
+// log_formats.txt is generated by tools/log_extract.py. The capture is read from stdin if no file is given. Bytes that
+// are not part of a log record (plain printf output) are copied through unchanged, and so are telemetry frames, which
+// share the UART: they are COBS encoded between 0x00 delimiters, and their contents may include the log marker.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+// Must match the encoder in src/drivers/logging/logging.cpp
+#define LOG_BINARY_MARKER 0xFE
+#define LOG_MAX_ARGS 4
+// Must match src/drivers/telemetry/telemetry.cpp
+#define TELEMETRY_DELIMITER 0x00
+enum ArgType { INT, UINT, INT64, UINT64, DOUBLE, STRING, POINTER };
+
+static const char *level_names[] = {"Verbose", "Information", "Warning", "Error"};
+
+struct Arg {
+    int type;
+    uint64_t u;
+    int64_t i;
+    double d;
+    std::string s;
+};
+
+static std::map<uint16_t, std::string> formats;
+
+// Load the table written by log_extract.py
+static bool load_formats(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) {
+        return false;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        char *tab = strchr(line, '\t');
+        if (tab == nullptr) {
+            continue;
+        }
+        uint16_t id = (uint16_t)strtoul(line, nullptr, 16);
+        std::string fmt;
+        for (char *p = tab + 1; *p != '\0' && *p != '\n'; p++) {
+            if (*p == '\\' && p[1] != '\0') {
+                p++;
+                fmt += *p == 'n' ? '\n' : *p == 'r' ? '\r' : *p == 't' ? '\t' : *p;
+            } else {
+                fmt += *p;
+            }
+        }
+        formats[id] = fmt;
+    }
+    fclose(f);
+    return true;
+}
+
+static bool read_varint(FILE *in, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(in);
+        if (c == EOF) {
+            return false;
+        }
+        *value |= (uint64_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Format one conversion with a decoded argument, fixing up the length modifier to suit it
+static std::string format_arg(const std::string &spec, const Arg *arg)
+{
+    char conv = spec.back();
+    std::string f;
+    for (size_t i = 0; i + 1 < spec.size(); i++) {
+        if (strchr("hljztL", spec[i]) == nullptr) {
+            f += spec[i];
+        }
+    }
+    char out[256];
+    if (arg == nullptr) {
+        return "(missing)";
+    }
+    if (conv == 's') {
+        snprintf(out, sizeof(out), (f + 's').c_str(), arg->type == STRING ? arg->s.c_str() : "(?)");
+    } else if (conv == 'p') {
+        snprintf(out, sizeof(out), "0x%llx", (unsigned long long)arg->u);
+    } else if (strchr("fFeEgGaA", conv) != nullptr) {
+        double v = arg->type == DOUBLE ? arg->d : (arg->type == INT || arg->type == INT64) ? arg->i : arg->u;
+        snprintf(out, sizeof(out), (f + conv).c_str(), v);
+    } else {
+        long long v = arg->type == DOUBLE ? (long long)arg->d : (arg->type == INT || arg->type == INT64) ? arg->i : (long long)arg->u;
+        if (conv == 'c') {
+            snprintf(out, sizeof(out), (f + 'c').c_str(), (int)v);
+        } else {
+            snprintf(out, sizeof(out), (f + "ll" + conv).c_str(), v);
+        }
+    }
+    return out;
+}
+
+static std::string format_message(const std::string &fmt, const Arg *args, size_t count)
+{
+    std::string out;
+    size_t arg = 0;
+    for (size_t i = 0; i < fmt.size(); i++) {
+        if (fmt[i] != '%') {
+            out += fmt[i];
+            continue;
+        }
+        if (i + 1 < fmt.size() && fmt[i + 1] == '%') {
+            out += '%';
+            i++;
+            continue;
+        }
+        size_t end = fmt.find_first_of("diouxXcspfFeEgGaA", i + 1);
+        if (end == std::string::npos) {
+            break;
+        }
+        out += format_arg(fmt.substr(i, end - i + 1), arg < count ? &args[arg] : nullptr);
+        arg++;
+        i = end;
+    }
+    return out;
+}
+
+// Decode one record, the marker having been read. Returns false at the end of the input.
+static bool decode_record(FILE *in, uint64_t *time_us)
+{
+    uint64_t header, time, types;
+    if (!read_varint(in, &header) || !read_varint(in, &time) || !read_varint(in, &types)) {
+        return false;
+    }
+    uint16_t id = (uint16_t)(header >> 3);
+    *time_us = (header & 4) ? time : *time_us + time;
+
+    Arg args[LOG_MAX_ARGS];
+    size_t count = types & 7;
+    if (count > LOG_MAX_ARGS) {
+        fprintf(stderr, "logdecode: corrupt record\n");
+        return true;
+    }
+    for (size_t i = 0; i < count; i++) {
+        Arg &a = args[i];
+        a.type = (types >> (3 + 3 * i)) & 7;
+        uint64_t v = 0;
+        if (a.type == DOUBLE) {
+            uint8_t b[4];
+            float f;
+            if (fread(b, 1, 4, in) != 4) {
+                return false;
+            }
+            memcpy(&f, b, 4);
+            a.d = f;
+        } else if (a.type == STRING) {
+            if (!read_varint(in, &v)) {
+                return false;
+            }
+            a.s.resize(v);
+            if (v > 0 && fread(&a.s[0], 1, v, in) != v) {
+                return false;
+            }
+        } else {
+            if (!read_varint(in, &v)) {
+                return false;
+            }
+            a.u = v;
+            a.i = (a.type == INT || a.type == INT64) ? unzigzag(v) : (int64_t)v;
+        }
+    }
+
+    std::string msg;
+    auto fmt = formats.find(id);
+    if (fmt != formats.end()) {
+        msg = format_message(fmt->second, args, count);
+    } else {
+        char unknown[32];
+        snprintf(unknown, sizeof(unknown), "<unknown message %04x>", id);
+        msg = unknown;
+    }
+    uint32_t ms = (uint32_t)(*time_us / 1000);
+    printf("[%u.%03u %s]: %s\n", ms / 1000, ms % 1000, level_names[header & 3], msg.c_str());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s log_formats.txt [capture.bin]\n", argv[0]);
+        return 2;
+    }
+    if (!load_formats(argv[1])) {
+        fprintf(stderr, "logdecode: cannot read %s\n", argv[1]);
+        return 1;
+    }
+    FILE *in = stdin;
+    if (argc > 2) {
+        in = fopen(argv[2], "rb");
+        if (in == nullptr) {
+            fprintf(stderr, "logdecode: cannot read %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    uint64_t time_us = 0;
+    bool in_frame = false; // Between the delimiters of a telemetry frame
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        if (c == TELEMETRY_DELIMITER) {
+            in_frame = !in_frame;
+            putchar(c);
+        } else if (c == LOG_BINARY_MARKER && !in_frame) {
+            if (!decode_record(in, &time_us)) {
+                break;
+            }
+        } else {
+            putchar(c);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Parse the binary telemetry stream sent by src/drivers/telemetry on the Raspberry Pi side.
+
+Usage as a script prints one record per line:
+    python3 telemetry.py /dev/serial0        (configure the port for 115200 baud raw mode first, e.g. with stty)
+    python3 telemetry.py capture.bin
+
+Usage as a library:
+    for record in telemetry.read_records(stream):
+        ...
+"""
+
+import struct
+import sys
+from collections import namedtuple
+
+TELEM_WEIGHT = 1
+TELEM_LAP = 2
+TELEM_SPEED = 3
+TELEM_DISTANCE = 4
+TELEM_BATCH = 5
+
+# Batch channels and modes, matching telemetry_batch.h
+CHANNEL_NAMES = {0: 'weight', 1: 'distance', 2: 'speed', 3: 'lap'}
+BATCH_SUMMARY = 1
+BATCH_RAW = 2
+
+Record = namedtuple('Record', 'type sequence timestamp_ms fields')
+
+# Payload layout and field names for each record type
+PAYLOADS = {
+    TELEM_WEIGHT: ('<iB', ('weight_g', 'flags')),
+    TELEM_LAP: ('<I', ('lap_ms',)),
+    TELEM_SPEED: ('<i', ('speed_mm_s',)),
+    TELEM_DISTANCE: ('<H', ('distance_mm',)),
+}
+TYPE_NAMES = {TELEM_WEIGHT: 'weight', TELEM_LAP: 'lap', TELEM_SPEED: 'speed', TELEM_DISTANCE: 'distance',
+              TELEM_BATCH: 'batch'}
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, matching telemetry_crc16()."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Undo COBS framing. Returns None if the data is not valid COBS."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def parse_batch(payload):
+    """Decode a TELEM_BATCH payload into {'window_ms': ..., 'channels': {name: section}}, or None if it is malformed.
+
+    A summary section is {'count', 'min', 'max', 'mean'}; a raw section is {'count', 'samples': [(offset_ms, value)]}.
+    """
+    if len(payload) < 2:
+        return None
+    window_ms, = struct.unpack_from('<H', payload, 0)
+    channels = {}
+    offset = 2
+    while offset < len(payload):
+        if offset + 4 > len(payload):
+            return None
+        channel, mode, count = struct.unpack_from('<BBH', payload, offset)
+        offset += 4
+        name = CHANNEL_NAMES.get(channel, channel)
+        if mode == BATCH_SUMMARY:
+            if offset + 12 > len(payload):
+                return None
+            low, high, mean = struct.unpack_from('<iii', payload, offset)
+            channels[name] = {'count': count, 'min': low, 'max': high, 'mean': mean}
+            offset += 12
+        elif mode == BATCH_RAW:
+            if offset + 6 * count > len(payload):
+                return None
+            samples = [struct.unpack_from('<Hi', payload, offset + 6 * i) for i in range(count)]
+            channels[name] = {'count': count, 'samples': samples}
+            offset += 6 * count
+        else:
+            return None
+    return {'window_ms': window_ms, 'channels': channels}
+
+
+def parse_frame(encoded):
+    """Decode one frame (without delimiters). Returns a Record, or None if the frame is corrupt."""
+    frame = cobs_decode(encoded)
+    if frame is None or len(frame) < 8:
+        return None
+    body, crc = frame[:-2], struct.unpack('<H', frame[-2:])[0]
+    if crc16(body) != crc:
+        return None
+    rtype, sequence, timestamp_ms = struct.unpack('<BBI', body[:6])
+    payload = body[6:]
+    if rtype == TELEM_BATCH:
+        fields = parse_batch(payload)
+        if fields is None:
+            return None
+    elif rtype in PAYLOADS:
+        fmt, names = PAYLOADS[rtype]
+        if len(payload) != struct.calcsize(fmt):
+            return None
+        fields = dict(zip(names, struct.unpack(fmt, payload)))
+    else:
+        fields = {'raw': payload}
+    return Record(rtype, sequence, timestamp_ms, fields)
+
+
+def read_records(stream):
+    """Yield the valid records in a binary stream, skipping console text and corrupt frames."""
+    buffer = bytearray()
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            return
+        if chunk[0] != 0:
+            buffer += chunk
+            continue
+        if buffer:
+            record = parse_frame(bytes(buffer))
+            if record is not None:
+                yield record
+            buffer.clear()
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__, file=sys.stderr)
+        return 2
+    with open(sys.argv[1], 'rb', buffering=0) as stream:
+        for record in read_records(stream):
+            fields = ' '.join(f'{k}={v}' for k, v in record.fields.items())
+            print(f'{record.timestamp_ms / 1000:.3f} #{record.sequence} {TYPE_NAMES.get(record.type, record.type)} {fields}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())